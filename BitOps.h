@@ -0,0 +1,157 @@
+/**
+ * Word operations shared by the bit-vector classes (BitRank, BlockedBitRank).
+ *
+ * The rank/select templates of the bit-vectors are instantiated once per
+ * Ops class below; the POPCNT and BMI2 instances are compiled with the
+ * corresponding target attribute and used only if cpuSupports() says so.
+ * Include only in .cpp files: the tables have internal linkage.
+ */
+
+#ifndef _BITOPS_H_
+#define _BITOPS_H_
+
+#include "Tools.h"
+
+#include <string>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define BITOPS_X86
+#endif
+
+const unsigned char __popcount_tab[] =
+{
+0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4,1,2,2,3,2,3,3,4,2,3,3,4,3,4,4,5,
+1,2,2,3,2,3,3,4,2,3,3,4,3,4,4,5,2,3,3,4,3,4,4,5,3,4,4,5,4,5,5,6,
+1,2,2,3,2,3,3,4,2,3,3,4,3,4,4,5,2,3,3,4,3,4,4,5,3,4,4,5,4,5,5,6,
+2,3,3,4,3,4,4,5,3,4,4,5,4,5,5,6,3,4,4,5,4,5,5,6,4,5,5,6,5,6,6,7,
+1,2,2,3,2,3,3,4,2,3,3,4,3,4,4,5,2,3,3,4,3,4,4,5,3,4,4,5,4,5,5,6,
+2,3,3,4,3,4,4,5,3,4,4,5,4,5,5,6,3,4,4,5,4,5,5,6,4,5,5,6,5,6,6,7,
+2,3,3,4,3,4,4,5,3,4,4,5,4,5,5,6,3,4,4,5,4,5,5,6,4,5,5,6,5,6,6,7,
+3,4,4,5,4,5,5,6,4,5,5,6,5,6,6,7,4,5,5,6,5,6,6,7,5,6,6,7,6,7,7,8,
+};
+
+const unsigned char select_tab[] =
+{
+0,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,5,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,
+
+6,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,5,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,
+
+7,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,5,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,
+
+6,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,5,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,
+
+8,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,5,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,
+
+6,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,5,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,
+
+7,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,5,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,
+
+6,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,5,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,
+};
+
+
+#if __WORDSIZE == 32
+    // 32 bit version
+    inline unsigned popcount (register ulong x){
+        return __popcount_tab[(x >>  0) & 0xff]  + __popcount_tab[(x >>  8) & 0xff]  + __popcount_tab[(x >> 16) & 0xff] + __popcount_tab[(x >> 24) & 0xff];
+    }
+#else
+    // 64 bit version
+    inline unsigned popcount (register ulong x){
+        return __popcount_tab[(x >>  0) & 0xff]  + __popcount_tab[(x >>  8) & 0xff]  + __popcount_tab[(x >> 16) & 0xff] + __popcount_tab[(x >> 24) & 0xff] + __popcount_tab[(x >> 32) & 0xff] + __popcount_tab[(x >> 40) & 0xff] + __popcount_tab[(x >> 48) & 0xff] + __popcount_tab[(x >> 56) & 0xff];
+    }
+#endif
+
+inline unsigned popcount16 (register int x){
+  return __popcount_tab[x & 0xff]  + __popcount_tab[(x >>  8) & 0xff];
+}
+
+inline unsigned popcount8 (register int x){
+  return __popcount_tab[x & 0xff];
+}
+
+// Portable version using the lookup tables
+struct TableOps
+{
+    static inline unsigned popcount(ulong x)
+    { return ::popcount(x); }
+
+    // Position of the k:th 1-bit in x, 1 <= k <= popcount(x)
+    static inline unsigned selectWord(ulong x, unsigned k)
+    {
+        unsigned pos = 0;
+        unsigned ones = popcount8(x);
+        while (ones < k) {
+            k -= ones;
+            x >>= 8;
+            pos += 8;
+            ones = popcount8(x);
+        }
+        while (true) {
+            unsigned step = select_tab[x & 0xff]; // 1 + position of the lowest 1-bit in the byte
+            if (--k == 0)
+                return pos + step - 1;
+            x >>= step;
+            pos += step;
+        }
+    }
+};
+
+// POPCNT instruction, in-word select from the tables
+struct PopcntOps
+{
+    static inline unsigned popcount(ulong x)
+    { return __builtin_popcountl(x); }
+
+    static inline unsigned selectWord(ulong x, unsigned k)
+    {
+        unsigned pos = 0;
+        unsigned ones = __builtin_popcountl(x & 0xff);
+        while (ones < k) {
+            k -= ones;
+            x >>= 8;
+            pos += 8;
+            ones = __builtin_popcountl(x & 0xff);
+        }
+        while (--k)
+            x &= x - 1; // clear the lowest 1-bit
+        return pos + __builtin_ctzl(x);
+    }
+};
+
+#ifdef BITOPS_X86
+// POPCNT, and PDEP to deposit the k:th 1-bit followed by TZCNT
+struct Bmi2Ops
+{
+    static inline unsigned popcount(ulong x)
+    { return __builtin_popcountl(x); }
+
+    static inline unsigned selectWord(ulong x, unsigned k)
+    {
+        ulong r;
+        // Inline assembly: the intrinsic needs the bmi2 target in the caller
+        __asm__ ("pdep %2, %1, %0" : "=r" (r) : "r" (1lu << (k - 1)), "rm" (x));
+        return __builtin_ctzl(r);
+    }
+};
+#endif
+
+/**
+ * True if the CPU supports the given implementation:
+ * "table", "popcnt" or "bmi2".
+ */
+inline bool cpuSupports(std::string const &name)
+{
+    if (name == "table")
+        return true;
+#ifdef BITOPS_X86
+    __builtin_cpu_init();
+    if (name == "popcnt")
+        return __builtin_cpu_supports("popcnt");
+    if (name == "bmi2")
+        return __builtin_cpu_supports("popcnt") && __builtin_cpu_supports("bmi2");
+#endif
+    return false;
+}
+
+#endif
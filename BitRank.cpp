@@ -1,4 +1,6 @@
 #include "BitRank.h"
+#include "BitOps.h"
+#include <cstring>
 
 /*****************************************************************************
  * Copyright (C) 2005, Rodrigo Gonzalez, all rights reserved.                *
@@ -24,92 +26,107 @@
 //Rank(B,i)// 
 /////////////
 //This Class use a superblock size of 256-512 bits
-//and a block size of 32-64 bits also
+//and a block size of 32-64 bits also (see BitRank::Layout)
 
+BitRank::Layout BitRank::layout = BitRank::LAYOUT_DEFAULT;
 
-const unsigned char __popcount_tab[] =
+bool BitRank::useLayout(std::string const &name)
 {
-0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4,1,2,2,3,2,3,3,4,2,3,3,4,3,4,4,5,
-1,2,2,3,2,3,3,4,2,3,3,4,3,4,4,5,2,3,3,4,3,4,4,5,3,4,4,5,4,5,5,6,
-1,2,2,3,2,3,3,4,2,3,3,4,3,4,4,5,2,3,3,4,3,4,4,5,3,4,4,5,4,5,5,6,
-2,3,3,4,3,4,4,5,3,4,4,5,4,5,5,6,3,4,4,5,4,5,5,6,4,5,5,6,5,6,6,7,
-1,2,2,3,2,3,3,4,2,3,3,4,3,4,4,5,2,3,3,4,3,4,4,5,3,4,4,5,4,5,5,6,
-2,3,3,4,3,4,4,5,3,4,4,5,4,5,5,6,3,4,4,5,4,5,5,6,4,5,5,6,5,6,6,7,
-2,3,3,4,3,4,4,5,3,4,4,5,4,5,5,6,3,4,4,5,4,5,5,6,4,5,5,6,5,6,6,7,
-3,4,4,5,4,5,5,6,4,5,5,6,5,6,6,7,4,5,5,6,5,6,6,7,5,6,6,7,6,7,7,8,
-};
+    if (name == "default")
+        layout = LAYOUT_DEFAULT;
+    else if (name == "fast" && W == 64)
+        layout = LAYOUT_FAST;
+    else if (name == "small" && W == 64)
+        layout = LAYOUT_SMALL;
+    else
+        return false;
+    return true;
+}
 
-const unsigned char select_tab[] =
+char const * BitRank::layoutName(Layout l)
 {
-0,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,5,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,
-
-6,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,5,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,
-
-7,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,5,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,
-
-6,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,5,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,
-
-8,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,5,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,
-
-6,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,5,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,
-
-7,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,5,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,
-
-6,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,5,1,2,1,3,1,2,1,4,1,2,1,3,1,2,1,
-};
-
-
-// bits needed to represent a number between 0 and n
-inline ulong bits (ulong n){
-	ulong b = 0;
-	while (n) { b++; n >>= 1; }
-	return b;
+    switch (l)
+    {
+    case LAYOUT_FAST: return "fast";
+    case LAYOUT_SMALL: return "small";
+    default: return "default";
+    }
 }
 
-#if __WORDSIZE == 32
-    // 32 bit version
-    inline unsigned popcount (register ulong x){
-        return __popcount_tab[(x >>  0) & 0xff]  + __popcount_tab[(x >>  8) & 0xff]  + __popcount_tab[(x >> 16) & 0xff] + __popcount_tab[(x >> 24) & 0xff];
+/**
+ * Identify the layout from b and s and derive the other fields;
+ * returns false if the layout is not supported.
+ */
+bool BitRank::initLayout()
+{
+    if (b == W && s == 256)
+    {
+        lay = LAYOUT_DEFAULT;
+        absMask = ~0lu;
     }
-#else
-    // 64 bit version
-    inline unsigned popcount (register ulong x){
-        return __popcount_tab[(x >>  0) & 0xff]  + __popcount_tab[(x >>  8) & 0xff]  + __popcount_tab[(x >> 16) & 0xff] + __popcount_tab[(x >> 24) & 0xff] + __popcount_tab[(x >> 32) & 0xff] + __popcount_tab[(x >> 40) & 0xff] + __popcount_tab[(x >> 48) & 0xff] + __popcount_tab[(x >> 56) & 0xff];
+    else if (W == 64 && b == 256 && s == 256)
+    {
+        lay = LAYOUT_FAST;
+        absMask = (1lu << 40) - 1;
     }
-#endif
-
-inline unsigned popcount16 (register int x){
-  return __popcount_tab[x & 0xff]  + __popcount_tab[(x >>  8) & 0xff];
-}
-
-inline unsigned popcount8 (register int x){
-  return __popcount_tab[x & 0xff];
+    else if (W == 64 && b == 512 && s == 512)
+    {
+        lay = LAYOUT_SMALL;
+        absMask = (1lu << 37) - 1;
+    }
+    else
+        return false;
+    superFactor = s/W;
+    superShift = 0;
+    while ((1u << superShift) < s)
+        ++superShift;
+    return true;
 }
 
 BitRank::BitRank(ulong *bitarray, ulong n, bool owner) 
-    : data(0), owner(true), n(0), integers(0), b(0), s(0), Rs(0), Rb(0)
+    : data(0), owner(true), mapped(false), n(0), integers(0), b(0), s(0), superFactor(0), superShift(0), 
+      lay(0), absMask(0), Rs(0), Rb(0)
 {
     data=bitarray;
     this->owner = owner;
     this->n=n;  // length of bitarray in bits
     b = W; // b is a word
-    s=b*superFactor;
+    s = 256;
+    if (layout != LAYOUT_DEFAULT)
+        b = s = (layout == LAYOUT_FAST ? 256 : 512);
+    if (!initLayout())
+        throw std::runtime_error("BitRank::BitRank(): invalid rank directory layout.");
+    // Bit-vectors too long for the absolute count of a packed layout
+    // use the next larger layout: small -> fast -> default
+    if (lay == LAYOUT_SMALL && n > absMask)
+    {
+        b = s = 256;
+        initLayout();
+    }
+    if (lay == LAYOUT_FAST && n > absMask)
+    {
+        b = W;
+        initLayout();
+    }
     ulong aux=(n+1)%W;
     if (aux != 0)
         integers = (n+1)/W+1;
     else 
         integers = (n+1)/W;
     BuildRank();
+    hints.build(data, n, SelectHints::sample, s, superFactor, 0);
 }
 
 BitRank::~BitRank() {
+    if (mapped) return;
     delete [] Rs;
     delete [] Rb;
     if (owner) delete [] data;
 }
 
 BitRank::BitRank(std::FILE *file)
-    : data(0), owner(true), n(0), integers(0), b(0), s(0), Rs(0), Rb(0)
+    : data(0), owner(true), mapped(false), n(0), integers(0), b(0), s(0), superFactor(0), superShift(0), 
+      lay(0), absMask(0), Rs(0), Rb(0)
 {
     if (std::fread(&n, sizeof(ulong), 1, file) != 1)
         throw std::runtime_error("BitRank::BitRank(): file read error (n).");
@@ -119,6 +136,8 @@ BitRank::BitRank(std::FILE *file)
         throw std::runtime_error("BitRank::BitRank(): file read error (b).");
     if (std::fread(&s, sizeof(unsigned), 1, file) != 1)
         throw std::runtime_error("BitRank::BitRank(): file read error (s).");
+    if (!initLayout())
+        throw std::runtime_error("BitRank::BitRank(): incompatible rank directory in the file.");
 
     data = new ulong[integers];
     if (std::fread(data, sizeof(ulong), integers, file) != integers)
@@ -126,9 +145,13 @@ BitRank::BitRank(std::FILE *file)
     Rs = new ulong[n/s+1];
     if (std::fread(Rs, sizeof(ulong), n/s+1, file) != n/s+1)
         throw std::runtime_error("BitRank::BitRank(): file read error (Rs).");
-    Rb = new uchar[n/b+1];
-    if (std::fread(Rb, sizeof(uchar), n/b+1, file) != n/b+1)
-        throw std::runtime_error("BitRank::BitRank(): file read error (Rb).");
+    if (lay == LAYOUT_DEFAULT)
+    {
+        Rb = new uchar[n/b+1];
+        if (std::fread(Rb, sizeof(uchar), n/b+1, file) != n/b+1)
+            throw std::runtime_error("BitRank::BitRank(): file read error (Rb).");
+    }
+    hints.build(data, n, SelectHints::sample, s, superFactor, 0);
 }
 
 void BitRank::save(std::FILE *file)
@@ -146,17 +169,76 @@ void BitRank::save(std::FILE *file)
         throw std::runtime_error("BitRank::save(): file write error (data).");
     if (std::fwrite(Rs, sizeof(ulong), n/s+1, file) != n/s+1)
         throw std::runtime_error("BitRank::save(): file write error (Rs).");
-    if (std::fwrite(Rb, sizeof(uchar), n/b+1, file) != n/b+1)
+    if (Rb && std::fwrite(Rb, sizeof(uchar), n/b+1, file) != n/b+1)
         throw std::runtime_error("BitRank::save(): file write error (Rb).");
 }
 
+/**
+ * Use the arrays in place from the memory mapped index file,
+ * or make a private copy of them.
+ */
+BitRank::BitRank(MemoryMap const &mm, Record const &r, bool copy, SelectHints::Record const *h)
+    : data(0), owner(false), mapped(true), n(r.n), integers(r.integers), b(r.b), s(r.s), superFactor(0), superShift(0), 
+      lay(0), absMask(0), Rs(0), Rb(0)
+{
+    if (!initLayout())
+        throw std::runtime_error("BitRank::BitRank(): incompatible rank directory in the index file "
+                                 "(index was built with -DBLOCKED_RANK?).");
+    data = mm.at<ulong>(r.data, integers);
+    Rs = mm.at<ulong>(r.Rs, n/s+1);
+    if (lay == LAYOUT_DEFAULT)
+        Rb = mm.at<uchar>(r.Rb, n/b+1);
+    if (h && n)
+        hints.load(mm, *h, rank(n-1), n, copy);
+    if (!copy)
+        return;
+
+    ulong *tmp = new ulong[integers];
+    std::memcpy(tmp, data, integers * sizeof(ulong));
+    data = tmp;
+    tmp = new ulong[n/s+1];
+    std::memcpy(tmp, Rs, (n/s+1) * sizeof(ulong));
+    Rs = tmp;
+    if (Rb)
+    {
+        uchar *tmpb = new uchar[n/b+1];
+        std::memcpy(tmpb, Rb, (n/b+1) * sizeof(uchar));
+        Rb = tmpb;
+    }
+    owner = true;
+    mapped = false;
+}
+
+/**
+ * Write the arrays as page-aligned sections and fill in their records
+ */
+void BitRank::save(std::FILE *file, Record &r, SelectHints::Record &h)
+{
+    r.n = n;
+    r.integers = integers;
+    r.b = b;
+    r.s = s;
+    r.data = MemoryMap::write(file, data, integers * sizeof(ulong));
+    r.Rs = MemoryMap::write(file, Rs, (n/s+1) * sizeof(ulong));
+    r.Rb = Rb ? MemoryMap::write(file, Rb, (n/b+1) * sizeof(uchar)) : 0;
+    hints.save(file, h);
+}
+
+void BitRank::getRegions(std::vector<std::pair<void const *, ulong> > &regions) const
+{
+    regions.push_back(std::make_pair((void const *)data, integers * sizeof(ulong)));
+    regions.push_back(std::make_pair((void const *)Rs, (n/s+1) * sizeof(ulong)));
+    if (Rb)
+        regions.push_back(std::make_pair((void const *)Rb, (n/b+1) * sizeof(uchar)));
+    hints.getRegions(regions);
+}
+
 //Build the rank (blocks and superblocks)
 void BitRank::BuildRank()
 {
     ulong num_sblock = n/s;
     ulong num_block = n/b;
     Rs = new ulong[num_sblock+1];//+1 we add the 0 pos
-    Rb = new uchar[num_block+1];//+1 we add the 0 pos
 	
 	ulong j;
     Rs[0] = 0lu;
@@ -166,6 +248,19 @@ void BitRank::BuildRank()
 			Rs[j]=BuildRankSub((j-1)*superFactor,superFactor)+Rs[j-1];
 		}
     
+    if (lay != LAYOUT_DEFAULT)
+    {
+        // Pack the counts of the words inside the superblock into the entries
+        for (j=0;j<=num_sblock;j++)
+            if (lay == LAYOUT_FAST)
+                for (unsigned k = 1; k < 4; ++k)
+                    Rs[j] |= BuildRankSub(j*superFactor, k) << (32 + 8*k);
+            else
+                for (unsigned k = 1; k < 4; ++k)
+                    Rs[j] |= BuildRankSub(j*superFactor, 2*k) << (28 + 9*k);
+        return;
+    }
+    Rb = new uchar[num_block+1];//+1 we add the 0 pos
     Rb[0]=0;
     for (ulong k=1;k<=num_block;k++) {
         j = k / superFactor;
@@ -187,153 +282,178 @@ ulong BitRank::BuildRankSub(ulong ini, ulong bloques){
 }
 
 
-//this rank ask from 0 to n-1
-ulong BitRank::rank(ulong i)  const {
-    ++i; // the following gives sum of 1s before i 
-    return Rs[i>>8]+Rb[i>>wordShift]
-        +popcount(data[i >> wordShift] & ((1lu << (i & Wminusone))-1));
-}
+/**
+ * Rank and select for different instruction sets,
+ * instantiated for the Ops classes of BitOps.h
+ */
+struct BitRank::Impl
+{
+    //this rank ask from 0 to n-1
+    template<class Ops>
+    static inline ulong rank(BitRank const *br, ulong i)
+    {
+        ++i; // the following gives sum of 1s before i 
+        ulong w = i >> wordShift;
+        ulong last = Ops::popcount(br->data[w] & ((1lu << (i & Wminusone))-1));
+        if (br->lay == LAYOUT_DEFAULT)
+            return br->Rs[i>>8] + br->Rb[w] + last;
+        // Packed layouts: the count of the word is selected with masks
+        // instead of branches, which would be mispredicted
+        if (br->lay == LAYOUT_FAST)
+        {
+            ulong e = br->Rs[i>>8];
+            unsigned k = w & 3; // Entry holds the counts before words 1-3
+            return (e & br->absMask) + ((e >> (32 + 8*k)) & (0xff & -(ulong)(k != 0))) + last;
+        }
+        ulong e = br->Rs[i>>9];
+        unsigned k = w & 7; // Entry holds the counts before words 2, 4 and 6
+        unsigned odd = k & 1;
+        return (e & br->absMask) + ((e >> (28 + 9*(k/2))) & (0x1ff & -(ulong)(k > 1)))
+            + Ops::popcount(br->data[w - odd] & -(ulong)odd) + last;
+    }
 
-ulong BitRank::select(ulong x) const {
-    // returns i such that x=rank(i) && rank(i-1)<x or n if that i not exist
-    // first binary search over first level rank structure
-    // then sequential search using popcount over a int
-    // then sequential search using popcount over a char
-    // then sequential search bit a bit
-    
-    //binary search over first level rank structure
-    if (x == 0)
-        return 0;
-        
-    ulong l=0, r=n/s;
-    ulong mid=(l+r)/2;      
-    ulong rankmid = Rs[mid];
-    while (l<=r) {
-        if (rankmid<x)
-            l = mid+1;
-        else
-            r = mid-1;
-        mid = (l+r)/2;              
-        rankmid = Rs[mid];
-    }    
-    //sequential search using popcount over a int
-    ulong left;
-    left=mid*superFactor;
-    x-=rankmid;
-    ulong j;
-        j = data[left];
-    
-    unsigned ones = popcount(j);
-    while (ones < x) {
-        x-=ones;left++;
-        if (left > integers) 
-            return n;
-            
-            j = data[left];
+    template<class Ops>
+    static inline ulong select(BitRank const *br, ulong x)
+    {
+        // returns i such that x=rank(i) && rank(i-1)<x or n if that i not exist
+        // first binary search over first level rank structure
+        // then sequential search using popcount over a int
+        // then select inside the word
+        if (x == 0)
+            return 0;
         
-        ones = popcount(j);
-    }
-    //sequential search using popcount over a char
-    left=left*b; 
-    rankmid = popcount8(j);
-    if (rankmid < x) {
-        j=j>>8;
+        ulong l=0, r=br->n/br->s;
+        br->hints.range(x, l, r); // Narrow down the search range
+        ulong mid=(l+r)/2;      
+        ulong rankmid = (br->Rs[mid] & br->absMask);
+        while (l<=r) {
+            if (rankmid<x)
+                l = mid+1;
+            else
+                r = mid-1;
+            mid = (l+r)/2;              
+            rankmid = (br->Rs[mid] & br->absMask);
+        }    
+        //sequential search using popcount over a int
+        ulong left=mid*br->superFactor;
         x-=rankmid;
-        left+=8;
-        rankmid = popcount8(j);
-        if (rankmid < x) {
-            j=j>>8;
-            x-=rankmid;
-            left+=8;
-            rankmid = popcount8(j);
-            if (rankmid < x) {
-                j=j>>8;
-                x-=rankmid;
-                left+=8;
-            }
+        ulong j = br->data[left];
+        unsigned ones = Ops::popcount(j);
+        while (ones < x) {
+            x-=ones;left++;
+            if (left > br->integers) 
+                return br->n;
+            j = br->data[left];
+            ones = Ops::popcount(j);
         }
+        return left*W + Ops::selectWord(j, x);
     }
 
-    // then sequential search bit a bit
-    while (x>0) {
-        if  (j&1lu) x--;
-        j=j>>1;
-        left++;
-    }
-    return left-1;
-}
-
-ulong BitRank::select0(ulong x) const {
-    // returns i such that x=rank0(i) && rank0(i-1)<x or n if that i not exist
-    // first binary search over first level rank structure
-    // then sequential search using popcount over a int
-    // then sequential search using popcount over a char
-    // then sequential search bit a bit
-    
-    //binary search over first level rank structure
-    if (x == 0)
-        return 0;
+    template<class Ops>
+    static inline ulong select0(BitRank const *br, ulong x)
+    {
+        // returns i such that x=rank0(i) && rank0(i-1)<x or n if that i not exist
+        if (x == 0)
+            return 0;
         
-    ulong l=0, r=n/s;
-    ulong mid=(l+r)/2;
-    ulong rankmid = mid * s - Rs[mid];
-    while (l<=r) {
-        if (rankmid<x)
-            l = mid+1;
-        else
-            r = mid-1;
-        mid = (l+r)/2;              
-        rankmid = mid * s - Rs[mid];
-    }    
-    
-    //sequential search using popcount over a int
-    ulong left;
-    left=mid*superFactor;
-    x-=rankmid;
-    ulong j;
-        j = data[left];
-    
-    unsigned zeros = W - popcount(j);
-    while (zeros < x) {
-        x-=zeros;
-        left++;
-        if (left > integers) 
-            return n;
-            
-            j = data[left];
-        zeros = W - popcount(j);
-    }
-    
-    //sequential search using popcount over a char
-    left=left*b;
-    rankmid = 8 - popcount8(j);
-    if (rankmid < x) {
-        j=j>>8;
+        ulong l=0, r=br->n/br->s;
+        br->hints.range0(x, l, r);
+        ulong mid=(l+r)/2;
+        ulong rankmid = mid * br->s - (br->Rs[mid] & br->absMask);
+        while (l<=r) {
+            if (rankmid<x)
+                l = mid+1;
+            else
+                r = mid-1;
+            mid = (l+r)/2;              
+            rankmid = mid * br->s - (br->Rs[mid] & br->absMask);
+        }    
+        //sequential search using popcount over a int
+        ulong left=mid*br->superFactor;
         x-=rankmid;
-        left+=8;
-        rankmid = 8 - popcount8(j);
-        if (rankmid < x) {
-            j=j>>8;
-            x-=rankmid;
-            left+=8;
-            rankmid = 8 - popcount8(j);
-            if (rankmid < x) {
-                j=j>>8;
-                x-=rankmid;
-                left+=8;
-            }
+        ulong j = br->data[left];
+        unsigned zeros = W - Ops::popcount(j);
+        while (zeros < x) {
+            x-=zeros;
+            left++;
+            if (left > br->integers) 
+                return br->n;
+            j = br->data[left];
+            zeros = W - Ops::popcount(j);
         }
+        return left*W + Ops::selectWord(~j, x);
     }
 
-    // then sequential search bit a bit
-    while (x>0) {
-        if  (!(j&1lu)) x--;
-        j=j>>1;
-        left++;
+    static ulong rankTable(BitRank const *br, ulong i)
+    { return rank<TableOps>(br, i); }
+    static ulong selectTable(BitRank const *br, ulong x)
+    { return select<TableOps>(br, x); }
+    static ulong select0Table(BitRank const *br, ulong x)
+    { return select0<TableOps>(br, x); }
+
+#ifdef BITOPS_X86
+    __attribute__((target("popcnt"))) static ulong rankPopcnt(BitRank const *br, ulong i)
+    { return rank<PopcntOps>(br, i); }
+    __attribute__((target("popcnt"))) static ulong selectPopcnt(BitRank const *br, ulong x)
+    { return select<PopcntOps>(br, x); }
+    __attribute__((target("popcnt"))) static ulong select0Popcnt(BitRank const *br, ulong x)
+    { return select0<PopcntOps>(br, x); }
+
+    __attribute__((target("popcnt,bmi,bmi2"))) static ulong selectBmi2(BitRank const *br, ulong x)
+    { return select<Bmi2Ops>(br, x); }
+    __attribute__((target("popcnt,bmi,bmi2"))) static ulong select0Bmi2(BitRank const *br, ulong x)
+    { return select0<Bmi2Ops>(br, x); }
+#endif
+
+    static bool use(std::string const &name)
+    {
+        if (name == "table")
+        {
+            rankFn = rankTable;
+            selectFn = selectTable;
+            select0Fn = select0Table;
+            implName = "table";
+            return true;
+        }
+#ifdef BITOPS_X86
+        if (name == "popcnt" && cpuSupports(name))
+        {
+            rankFn = rankPopcnt;
+            selectFn = selectPopcnt;
+            select0Fn = select0Popcnt;
+            implName = "popcnt";
+            return true;
+        }
+        if (name == "bmi2" && cpuSupports(name))
+        {
+            rankFn = rankPopcnt; // rank needs only the popcount
+            selectFn = selectBmi2;
+            select0Fn = select0Bmi2;
+            implName = "bmi2";
+            return true;
+        }
+#endif
+        return false;
     }
-    return left - 1;
-}
 
+    // Select the best implementation supported by the CPU
+    static char const * init()
+    {
+        if (!use("bmi2") && !use("popcnt"))
+            use("table");
+        return implName;
+    }
+};
+
+BitRank::query_fn BitRank::rankFn = BitRank::Impl::rankTable;
+BitRank::query_fn BitRank::selectFn = BitRank::Impl::selectTable;
+BitRank::query_fn BitRank::select0Fn = BitRank::Impl::select0Table;
+char const *BitRank::implName = BitRank::Impl::init();
+
+bool BitRank::useImplementation(std::string const &name)
+{
+    return Impl::use(name);
+}
 
 bool BitRank::IsBitSet(ulong i) const {
     return (1lu << (i % W)) & data[i/W];
@@ -1,36 +1,97 @@
 #ifndef _BITRANK_H_
 #define _BITRANK_H_
 #include "Tools.h"
+#include "MemoryMap.h"
+#include "SelectHints.h"
 
 #include <cstdio>
 #include <stdexcept>
+#include <vector>
+#include <utility>
+#include <string>
 
 class BitRank {
 private:
 #if __WORDSIZE == 32
     static const unsigned wordShift = 5;
-    static const unsigned superFactor = 8; // 256 bit blocks
 #else
     static const unsigned wordShift = 6;
-    static const unsigned superFactor = 4; // 256 bit blocks
 #endif
     
     ulong *data; //here is the bit-array
     bool owner;
+    bool mapped; // Rs and Rb point inside a MemoryMap
     ulong n,integers;
     unsigned b,s; 
+    unsigned superFactor; // words per superblock
+    unsigned superShift;  // log2(s)
+    int lay;              // Layout, identified by b and s
+    ulong absMask;        // bits of the absolute count in the superblock entries
     ulong *Rs; //superblock array
-    uchar *Rb; //block array
+    uchar *Rb; //block array, 0 in the packed layouts
+    SelectHints hints;
 
     ulong BuildRankSub(ulong,  ulong); //internal use of BuildRank
     void BuildRank(); //crea indice para rank
+    bool initLayout();
+
+    // Rank and select kernels, selected at run time for the CPU (see BitRank.cpp)
+    struct Impl;
+    typedef ulong (*query_fn)(BitRank const *, ulong);
+    static query_fn rankFn;
+    static query_fn selectFn;
+    static query_fn select0Fn;
+    static char const *implName;
 public:
+    /**
+     * Layouts of the rank directory (see builder --rank-layout).
+     * LAYOUT_DEFAULT: 256 bit superblocks (Rs) and a byte count per word
+     * (Rb); rank reads three cache lines, 0.375 bits of directory per bit.
+     * LAYOUT_FAST: the counts of the words are packed into the 64 bit
+     * superblock entries next to a 40 bit absolute count; two cache lines,
+     * 0.25 bits per bit.
+     * LAYOUT_SMALL: 512 bit superblocks, the counts of every other word
+     * packed next to a 37 bit absolute count; two cache lines and up to
+     * two popcounts, 0.125 bits per bit.
+     * The packed layouts have b == s in the Record and need 64 bit words.
+     * Longer bit-vectors than the absolute count allows (2^40 or 2^37
+     * bits) fall back to the next larger layout when they are built.
+     */
+    enum Layout { LAYOUT_DEFAULT, LAYOUT_FAST, LAYOUT_SMALL };
+    // Layout of new bit-vectors
+    static Layout layout;
+    // Set the layout by name: "default", "fast" or "small"
+    static bool useLayout(std::string const &);
+    static char const * layoutName(Layout);
+    Layout getLayout() const
+    { return (Layout)lay; }
+
+    /**
+     * Fixed size record describing the sections of one bit-array
+     * in the page-aligned index layout (FMIndex v18).
+     */
+    struct Record
+    {
+        ulong n;
+        ulong integers;
+        unsigned b;
+        unsigned s;
+        ulong data; // file offsets of the arrays
+        ulong Rs;
+        ulong Rb;
+    };
+
     BitRank(ulong *, ulong, bool);
     BitRank(std::FILE *);
+    BitRank(MemoryMap const &, Record const &, bool = false, SelectHints::Record const * = 0);
     ~BitRank();    
     void save(std::FILE *);
+    void save(std::FILE *, Record &, SelectHints::Record &);
 
-    ulong rank(ulong i) const; //Rank from 0 to n-1
+    ulong rank(ulong i) const //Rank from 0 to n-1
+    {
+        return rankFn(this, i);
+    }
     ulong rank(bool b, ulong i) const 
     {
         return b?rank(i):(i+1-rank(i));
@@ -40,10 +101,38 @@ public:
         return i+1-rank(i);
     }
 
-    ulong select(ulong x) const; // gives the position of the x:th 1.
-    ulong select0(ulong x) const; // gives the position of the x:th 0.
+    ulong select(ulong x) const // gives the position of the x:th 1.
+    {
+        return selectFn(this, x);
+    }
+    ulong select0(ulong x) const // gives the position of the x:th 0.
+    {
+        return select0Fn(this, x);
+    }
 
     bool IsBitSet(ulong i) const;
+
+    // Prefetch the cache lines read by rank(i)
+    void prefetch(ulong i) const
+    {
+        ++i;
+        __builtin_prefetch(Rs + (i>>superShift));
+        if (Rb)
+            __builtin_prefetch(Rb + (i>>wordShift));
+        __builtin_prefetch(data + (i>>wordShift));
+    }
+
+    void getRegions(std::vector<std::pair<void const *, ulong> > &) const;
+
+    /**
+     * Name of the rank/select implementation in use: "table" (portable),
+     * "popcnt" (POPCNT instruction) or "bmi2" (POPCNT, PDEP and TZCNT).
+     * The best one supported by the CPU is selected at start up.
+     */
+    static char const * implementation()
+    { return implName; }
+    // Force the given implementation; returns false if the CPU does not support it
+    static bool useImplementation(std::string const &);
 };
 
 #endif
@@ -0,0 +1,341 @@
+#include "BlockedBitRank.h"
+#include "BitOps.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace
+{
+    // Fields of the directory word
+    const ulong ABS_MASK = (1lu << 40) - 1;
+    // Number of 1-bits before data words 1, 3 and 5 of the block
+    const unsigned REL_SHIFT[] = {0, 40, 47, 55};
+    const ulong REL_MASK[] = {0, 0x7f, 0xff, 0x1ff};
+
+    ulong * allocateBlocks(ulong words)
+    {
+        void *p = 0;
+        if (posix_memalign(&p, 64, words * sizeof(ulong)) != 0)
+            throw std::bad_alloc();
+        return (ulong *)p;
+    }
+}
+
+/**
+ * Rank and select for different instruction sets,
+ * instantiated for the Ops classes of BitOps.h
+ */
+struct BlockedBitRank::Impl
+{
+    template<class Ops>
+    static inline ulong rank(BlockedBitRank const *br, ulong i)
+    {
+        ++i; // the following gives sum of 1s before i
+        ulong const *block = br->blocks + (i / BLOCK_BITS) * BLOCK_WORDS;
+        unsigned off = i % BLOCK_BITS;
+        unsigned w = off / 64;
+        unsigned t = (w + 1) / 2; // Directory entry: 0 for word 0, 1 for words 1-2, etc.
+        ulong result = (block[0] & ABS_MASK) + ((block[0] >> REL_SHIFT[t]) & REL_MASK[t]);
+        // Words 2, 4 and 6 also count their previous word (block[w] is data word w-1)
+        result += Ops::popcount(block[w] & -(ulong)(w && (w & 1) == 0));
+        return result + Ops::popcount(block[1 + w] & ((1lu << (off % 64)) - 1));
+    }
+
+    template<class Ops>
+    static inline ulong select(BlockedBitRank const *br, ulong x)
+    {
+        // returns i such that x=rank(i) && rank(i-1)<x or n if that i not exist
+        if (x == 0)
+            return 0;
+
+        // Binary search for the last block having less than x 1-bits before it
+        ulong l = 0, r = br->nblocks - 1;
+        br->hints.range(x, l, r);
+        ++r;
+        while (r - l > 1)
+        {
+            ulong mid = (l + r) / 2;
+            if ((br->blocks[mid * BLOCK_WORDS] & ABS_MASK) < x)
+                l = mid;
+            else
+                r = mid;
+        }
+        ulong const *block = br->blocks + l * BLOCK_WORDS;
+        x -= block[0] & ABS_MASK;
+
+        // Skip words using the directory, then scan the remaining words
+        unsigned w = 0;
+        for (unsigned t = 3; t > 0; --t)
+        {
+            ulong rel = (block[0] >> REL_SHIFT[t]) & REL_MASK[t];
+            if (rel < x)
+            {
+                w = 2*t - 1;
+                x -= rel;
+                break;
+            }
+        }
+        for (; w < DATA_WORDS; ++w)
+        {
+            unsigned ones = Ops::popcount(block[1 + w]);
+            if (ones >= x)
+            {
+                ulong result = l * BLOCK_BITS + w * 64 + Ops::selectWord(block[1 + w], x);
+                return result < br->n ? result : br->n;
+            }
+            x -= ones;
+        }
+        return br->n;
+    }
+
+    template<class Ops>
+    static inline ulong select0(BlockedBitRank const *br, ulong x)
+    {
+        // returns i such that x=rank0(i) && rank0(i-1)<x or n if that i not exist
+        if (x == 0)
+            return 0;
+
+        ulong l = 0, r = br->nblocks - 1;
+        br->hints.range0(x, l, r);
+        ++r;
+        while (r - l > 1)
+        {
+            ulong mid = (l + r) / 2;
+            if (mid * BLOCK_BITS - (br->blocks[mid * BLOCK_WORDS] & ABS_MASK) < x)
+                l = mid;
+            else
+                r = mid;
+        }
+        ulong const *block = br->blocks + l * BLOCK_WORDS;
+        x -= l * BLOCK_BITS - (block[0] & ABS_MASK);
+
+        unsigned w = 0;
+        for (unsigned t = 3; t > 0; --t)
+        {
+            ulong rel = (2*t - 1) * 64 - ((block[0] >> REL_SHIFT[t]) & REL_MASK[t]);
+            if (rel < x)
+            {
+                w = 2*t - 1;
+                x -= rel;
+                break;
+            }
+        }
+        for (; w < DATA_WORDS; ++w)
+        {
+            unsigned zeros = 64 - Ops::popcount(block[1 + w]);
+            if (zeros >= x)
+            {
+                ulong result = l * BLOCK_BITS + w * 64 + Ops::selectWord(~block[1 + w], x);
+                return result < br->n ? result : br->n;
+            }
+            x -= zeros;
+        }
+        return br->n;
+    }
+
+    static ulong rankTable(BlockedBitRank const *br, ulong i)
+    { return rank<TableOps>(br, i); }
+    static ulong selectTable(BlockedBitRank const *br, ulong x)
+    { return select<TableOps>(br, x); }
+    static ulong select0Table(BlockedBitRank const *br, ulong x)
+    { return select0<TableOps>(br, x); }
+
+#ifdef BITOPS_X86
+    __attribute__((target("popcnt"))) static ulong rankPopcnt(BlockedBitRank const *br, ulong i)
+    { return rank<PopcntOps>(br, i); }
+    __attribute__((target("popcnt"))) static ulong selectPopcnt(BlockedBitRank const *br, ulong x)
+    { return select<PopcntOps>(br, x); }
+    __attribute__((target("popcnt"))) static ulong select0Popcnt(BlockedBitRank const *br, ulong x)
+    { return select0<PopcntOps>(br, x); }
+
+    __attribute__((target("popcnt,bmi,bmi2"))) static ulong selectBmi2(BlockedBitRank const *br, ulong x)
+    { return select<Bmi2Ops>(br, x); }
+    __attribute__((target("popcnt,bmi,bmi2"))) static ulong select0Bmi2(BlockedBitRank const *br, ulong x)
+    { return select0<Bmi2Ops>(br, x); }
+#endif
+
+    static bool use(std::string const &name)
+    {
+        if (name == "table")
+        {
+            rankFn = rankTable;
+            selectFn = selectTable;
+            select0Fn = select0Table;
+            implName = "table";
+            return true;
+        }
+#ifdef BITOPS_X86
+        if (name == "popcnt" && cpuSupports(name))
+        {
+            rankFn = rankPopcnt;
+            selectFn = selectPopcnt;
+            select0Fn = select0Popcnt;
+            implName = "popcnt";
+            return true;
+        }
+        if (name == "bmi2" && cpuSupports(name))
+        {
+            rankFn = rankPopcnt; // rank needs only the popcount
+            selectFn = selectBmi2;
+            select0Fn = select0Bmi2;
+            implName = "bmi2";
+            return true;
+        }
+#endif
+        return false;
+    }
+
+    // Select the best implementation supported by the CPU
+    static char const * init()
+    {
+        if (!use("bmi2") && !use("popcnt"))
+            use("table");
+        return implName;
+    }
+};
+
+BlockedBitRank::query_fn BlockedBitRank::rankFn = BlockedBitRank::Impl::rankTable;
+BlockedBitRank::query_fn BlockedBitRank::selectFn = BlockedBitRank::Impl::selectTable;
+BlockedBitRank::query_fn BlockedBitRank::select0Fn = BlockedBitRank::Impl::select0Table;
+char const *BlockedBitRank::implName = BlockedBitRank::Impl::init();
+
+bool BlockedBitRank::useImplementation(std::string const &name)
+{
+    return Impl::use(name);
+}
+
+BlockedBitRank::BlockedBitRank(ulong *bitarray, ulong n, bool owner)
+    : blocks(0), mapped(false), n(n), nblocks(0)
+{
+    build(bitarray);
+    if (owner)
+        delete [] bitarray;
+}
+
+/**
+ * Read the BitRank file format and rebuild the directory
+ */
+BlockedBitRank::BlockedBitRank(std::FILE *file)
+    : blocks(0), mapped(false), n(0), nblocks(0)
+{
+    ulong integers = 0;
+    unsigned b = 0, s = 0;
+    if (std::fread(&n, sizeof(ulong), 1, file) != 1)
+        throw std::runtime_error("BlockedBitRank::BlockedBitRank(): file read error (n).");
+    if (std::fread(&integers, sizeof(ulong), 1, file) != 1)
+        throw std::runtime_error("BlockedBitRank::BlockedBitRank(): file read error (integers).");
+    if (std::fread(&b, sizeof(unsigned), 1, file) != 1)
+        throw std::runtime_error("BlockedBitRank::BlockedBitRank(): file read error (b).");
+    if (std::fread(&s, sizeof(unsigned), 1, file) != 1)
+        throw std::runtime_error("BlockedBitRank::BlockedBitRank(): file read error (s).");
+    if (b == 0 || s == 0 || integers < (n + W - 1) / W)
+        throw std::runtime_error("BlockedBitRank::BlockedBitRank(): invalid bit-array header.");
+
+    ulong *data = new ulong[integers];
+    if (std::fread(data, sizeof(ulong), integers, file) != integers)
+    {
+        delete [] data;
+        throw std::runtime_error("BlockedBitRank::BlockedBitRank(): file read error (data).");
+    }
+    build(data);
+    delete [] data;
+
+    // Skip the BitRank directory
+    if (std::fseek(file, (n/s+1) * sizeof(ulong) + (n/b+1) * sizeof(uchar), SEEK_CUR) != 0)
+        throw std::runtime_error("BlockedBitRank::BlockedBitRank(): file read error (Rs, Rb).");
+}
+
+/**
+ * Use the blocks in place from the memory mapped index file,
+ * or make a private copy of them. A bit-array saved by BitRank
+ * (index version 18) is converted.
+ */
+BlockedBitRank::BlockedBitRank(MemoryMap const &mm, Record const &r, bool copy, SelectHints::Record const *h)
+    : blocks(0), mapped(false), n(r.n), nblocks(0)
+{
+    if (r.b == W && r.s == 4*W)
+    {
+        if (r.integers < (n + W - 1) / W)
+            throw std::runtime_error("BlockedBitRank::BlockedBitRank(): invalid bit-array record.");
+        build(mm.at<ulong>(r.data, r.integers));
+        return;
+    }
+    if (r.b != BLOCK_BITS || r.s != BLOCK_WORDS * W)
+        throw std::runtime_error("BlockedBitRank::BlockedBitRank(): incompatible rank directory in the index file.");
+
+    nblocks = n / BLOCK_BITS + 1;
+    if (r.integers != nblocks * BLOCK_WORDS)
+        throw std::runtime_error("BlockedBitRank::BlockedBitRank(): invalid bit-array record.");
+    blocks = mm.at<ulong>(r.data, r.integers);
+    mapped = true;
+    if (h && n)
+        hints.load(mm, *h, rank(n-1), n, copy);
+    if (!copy)
+        return;
+
+    ulong *tmp = allocateBlocks(r.integers);
+    std::memcpy(tmp, blocks, r.integers * sizeof(ulong));
+    blocks = tmp;
+    mapped = false;
+}
+
+BlockedBitRank::~BlockedBitRank()
+{
+    if (!mapped)
+        std::free(blocks);
+}
+
+/**
+ * Write the blocks as a page-aligned section and fill in the record
+ */
+void BlockedBitRank::save(std::FILE *file, Record &r, SelectHints::Record &h)
+{
+    r.n = n;
+    r.integers = nblocks * BLOCK_WORDS;
+    r.b = BLOCK_BITS;
+    r.s = BLOCK_WORDS * W;
+    r.data = MemoryMap::write(file, blocks, nblocks * BLOCK_WORDS * sizeof(ulong));
+    r.Rs = 0;
+    r.Rb = 0;
+    hints.save(file, h);
+}
+
+void BlockedBitRank::getRegions(std::vector<std::pair<void const *, ulong> > &regions) const
+{
+    regions.push_back(std::make_pair((void const *)blocks, nblocks * BLOCK_WORDS * sizeof(ulong)));
+    hints.getRegions(regions);
+}
+
+/**
+ * Copy the given bit-array of length n into blocks
+ * and fill in the directory words.
+ */
+void BlockedBitRank::build(ulong const *data)
+{
+    if (n > MAX_BITS)
+        throw std::runtime_error("BlockedBitRank::build(): bit-array is too long.");
+    nblocks = n / BLOCK_BITS + 1;
+    blocks = allocateBlocks(nblocks * BLOCK_WORDS);
+
+    ulong words = (n + W - 1) / W; // Words of the input
+    ulong total = 0;
+    for (ulong i = 0; i < nblocks; ++i)
+    {
+        ulong *block = blocks + i * BLOCK_WORDS;
+        ulong rel[DATA_WORDS + 1];
+        rel[0] = 0;
+        for (unsigned w = 0; w < DATA_WORDS; ++w)
+        {
+            ulong j = i * DATA_WORDS + w;
+            ulong x = j < words ? data[j] : 0;
+            if (j == words - 1 && n % W)
+                x &= (1lu << (n % W)) - 1; // Clear the bits after n
+            block[1 + w] = x;
+            rel[w + 1] = rel[w] + popcount(x);
+        }
+        block[0] = total | rel[1] << REL_SHIFT[1] | rel[3] << REL_SHIFT[2] | rel[5] << REL_SHIFT[3];
+        total += rel[DATA_WORDS];
+    }
+    hints.build(blocks, n, SelectHints::sample, BLOCK_BITS, BLOCK_WORDS, 1);
+}
@@ -0,0 +1,108 @@
+/**
+ * Bit-vector with a cache-line blocked rank directory.
+ *
+ * The bits are stored in 64 byte blocks of 8 words: the first word
+ * holds the rank directory of the block, the remaining 7 words hold
+ * 448 bits of data. The directory word contains the number of 1-bits
+ * before the block (40 bits) and the number of 1-bits before data
+ * words 1, 3 and 5 of the block (7, 8 and 9 bits). Thus rank() reads
+ * one cache line and needs at most two popcounts. Space overhead is
+ * 1/8 of the blocks, compared to 3/8 in BitRank.
+ *
+ * Interface is the same as in BitRank; HuffWT uses this class
+ * if compiled with -DBLOCKED_RANK (index version 19).
+ */
+
+#ifndef _BLOCKEDBITRANK_H_
+#define _BLOCKEDBITRANK_H_
+
+#include "BitRank.h"
+
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+#include <utility>
+#include <string>
+
+class BlockedBitRank
+{
+public:
+    static const unsigned BLOCK_WORDS = 8;
+    static const unsigned DATA_WORDS = 7;
+    static const unsigned BLOCK_BITS = DATA_WORDS * 64;
+    // Maximum number of bits (40 bit counters)
+    static const ulong MAX_BITS = (1lu << 40) - 1;
+
+    // Same record as in BitRank: b and s identify the layout
+    typedef BitRank::Record Record;
+
+    BlockedBitRank(ulong *, ulong, bool);
+    BlockedBitRank(std::FILE *);
+    BlockedBitRank(MemoryMap const &, Record const &, bool = false, SelectHints::Record const * = 0);
+    ~BlockedBitRank();
+    void save(std::FILE *, Record &, SelectHints::Record &);
+
+    ulong rank(ulong i) const //Rank from 0 to n-1
+    {
+        return rankFn(this, i);
+    }
+    ulong rank(bool b, ulong i) const
+    {
+        return b?rank(i):(i+1-rank(i));
+    }
+    ulong rank0(ulong i) const
+    {
+        return i+1-rank(i);
+    }
+    ulong select(ulong x) const // gives the position of the x:th 1.
+    {
+        return selectFn(this, x);
+    }
+    ulong select0(ulong x) const // gives the position of the x:th 0.
+    {
+        return select0Fn(this, x);
+    }
+
+    bool IsBitSet(ulong i) const
+    {
+        ulong const *block = blocks + (i / BLOCK_BITS) * BLOCK_WORDS;
+        i %= BLOCK_BITS;
+        return (block[1 + i / 64] >> (i % 64)) & 1lu;
+    }
+
+    // Prefetch the cache line read by rank(i)
+    void prefetch(ulong i) const
+    {
+        __builtin_prefetch(blocks + ((i+1) / BLOCK_BITS) * BLOCK_WORDS);
+    }
+
+    void getRegions(std::vector<std::pair<void const *, ulong> > &) const;
+
+    // See BitRank::implementation()
+    static char const * implementation()
+    { return implName; }
+    static bool useImplementation(std::string const &);
+
+private:
+    ulong *blocks;
+    bool mapped; // blocks point inside a MemoryMap
+    ulong n;
+    ulong nblocks;
+    SelectHints hints;
+
+    void build(ulong const *);
+
+    // Rank and select kernels, selected at run time for the CPU
+    struct Impl;
+    typedef ulong (*query_fn)(BlockedBitRank const *, ulong);
+    static query_fn rankFn;
+    static query_fn selectFn;
+    static query_fn select0Fn;
+    static char const *implName;
+
+    // No copy constructor or assignment
+    BlockedBitRank(BlockedBitRank const&);
+    BlockedBitRank& operator = (BlockedBitRank const&);
+};
+
+#endif
@@ -16,11 +16,23 @@ void error(const char *msg)
     exit(1);
 }
 
-ClientSocket::ClientSocket(std::string const &host, int port)
-    : n(0), sockfd(0)
+ClientSocket::ClientSocket(std::string const &host, int port, unsigned bufferSize_, unsigned depth_)
+    : buffer(0), n(0), sockfd(0), bufferSize(bufferSize_), depth(depth_), buffers(0), length(0), 
+      head(0), pending(0), closing(false)
 {
-    for (unsigned i = 0; i < BUFFER_SIZE; ++i)
-        buffer[0] = 0;
+    if (bufferSize == 0)
+        bufferSize = DEFAULT_BUFFER_SIZE;
+    if (depth == 0)
+        depth = 1;
+
+    buffers = new char *[depth];
+    length = new unsigned[depth];
+    for (unsigned i = 0; i < depth; ++i)
+    {
+        buffers[i] = new char[bufferSize];
+        length[i] = 0;
+    }
+    buffer = buffers[0];
 
     /** 
      * Init the socket connection
@@ -44,6 +56,15 @@ ClientSocket::ClientSocket(std::string const &host, int port)
 
     if (connect(sockfd,(struct sockaddr *) &serv_addr,sizeof(serv_addr)) < 0) 
         error("ERROR connecting");
+
+    if (depth > 1)
+    {
+        pthread_mutex_init(&mutex, 0);
+        pthread_cond_init(&notEmpty, 0);
+        pthread_cond_init(&notFull, 0);
+        if (pthread_create(&thread, 0, ClientSocket::sender, this) != 0)
+            error("ERROR creating the sender thread");
+    }
 }
 
 /* Write "n" bytes to a descriptor. (UNIX Network Programming, Andrew M. Rudoff, Bill Fenner, W. Richard Stevens, 2004) */
@@ -109,16 +130,84 @@ void ClientSocket::flushBuffer()
             std::cerr << buffer[i];
             cerr << "\"" << endl;*/
 
-    if (writen(sockfd, buffer, n) != n)
-        error("ERROR writing the output");
+    if (depth == 1)
+    {
+        if (writen(sockfd, buffer, n) != n)
+            error("ERROR writing the output");
+        n = 0;
+        return;
+    }
 
+    // Queue the current buffer and wait until the next one has been drained
+    pthread_mutex_lock(&mutex);
+    unsigned cur = (head + pending) % depth;
+    length[cur] = n;
+    ++pending;
+    pthread_cond_signal(&notEmpty);
+    while (pending == depth)
+        pthread_cond_wait(&notFull, &mutex);
+    pthread_mutex_unlock(&mutex);
+
+    buffer = buffers[(cur + 1) % depth];
     n = 0;
 }
 
+void * ClientSocket::sender(void *cs)
+{
+    ((ClientSocket *)cs)->sendBuffers();
+    return 0;
+}
+
+/**
+ * Main loop of the sender thread
+ */
+void ClientSocket::sendBuffers()
+{
+    pthread_mutex_lock(&mutex);
+    while (true)
+    {
+        while (pending == 0 && !closing)
+            pthread_cond_wait(&notEmpty, &mutex);
+        if (pending == 0)
+            break; // closing and all buffers sent
+        
+        char *buf = buffers[head];
+        unsigned len = length[head];
+        pthread_mutex_unlock(&mutex);
+
+        if (writen(sockfd, buf, len) != len)
+            error("ERROR writing the output");
+
+        pthread_mutex_lock(&mutex);
+        head = (head + 1) % depth;
+        --pending;
+        pthread_cond_signal(&notFull);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
 ClientSocket::~ClientSocket()
 {
     if (n)
         flushBuffer(); // Pending bytes in buffer
+
+    if (depth > 1)
+    {
+        pthread_mutex_lock(&mutex);
+        closing = true;
+        pthread_cond_signal(&notEmpty);
+        pthread_mutex_unlock(&mutex);
+        pthread_join(thread, 0);
+
+        pthread_cond_destroy(&notFull);
+        pthread_cond_destroy(&notEmpty);
+        pthread_mutex_destroy(&mutex);
+    }
     close(sockfd);
+
+    for (unsigned i = 0; i < depth; ++i)
+        delete [] buffers[i];
+    delete [] buffers;
+    delete [] length;
 }
 
@@ -3,15 +3,30 @@
 
 #include "Tools.h"
 
+#include <pthread.h>
+
+/**
+ * Buffered output to a metaserver process.
+ *
+ * With a buffer depth of 1 the full buffer is written with a blocking
+ * send() by the calling thread. With depth > 1, full buffers are handed
+ * to a dedicated sender thread so that the caller can keep filling the
+ * next buffer while the previous ones drain.
+ */
 class ClientSocket
 {
 public:
-    ClientSocket(std::string const &, int );
+    static const unsigned DEFAULT_BUFFER_SIZE = 16*1024; ///1024*1024;
+    static const unsigned DEFAULT_BUFFER_DEPTH = 2;
+    // Limit of the send buffers of one connection (size times depth)
+    static const ulong MAX_BUFFER_MEMORY = 1024*1024*1024;
+
+    ClientSocket(std::string const &, int, unsigned = DEFAULT_BUFFER_SIZE, unsigned = DEFAULT_BUFFER_DEPTH);
     virtual ~ClientSocket();
 
     inline void putc(char c)
     {
-        if (n == BUFFER_SIZE)
+        if (n == bufferSize)
             flushBuffer();
 
         buffer[n++] = c;
@@ -78,15 +93,28 @@ public:
 
 protected:
     void flushBuffer();
-
-    static const unsigned BUFFER_SIZE = 16*1024; ///1024*1024;
+    void sendBuffers();
+    static void * sender(void *);
 
     ssize_t readnonblocking(int fd, char *vptr, size_t n);
 
-    char buffer[BUFFER_SIZE];
-    unsigned n; // number of bytes in buffer
+    char *buffer;      // buffer currently being filled
+    unsigned n;        // number of bytes in buffer
     int sockfd;
 
+    // Ring of buffers shared with the sender thread
+    unsigned bufferSize;
+    unsigned depth;
+    char **buffers;
+    unsigned *length;  // bytes in each queued buffer
+    unsigned head;     // next buffer to send
+    unsigned pending;  // number of queued buffers
+    bool closing;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+
 private:
     ClientSocket();
     // No copy constructor and assignment
@@ -0,0 +1,393 @@
+#include "DNARank.h"
+#include "BitOps.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <algorithm>
+
+namespace
+{
+    const ulong LOW_FIELDS = 0x5555555555555555lu; // low bit of each 2-bit field
+
+    ulong * allocateBlocks(ulong words)
+    {
+        void *p = 0;
+        if (posix_memalign(&p, 64, (words ? words : 1) * sizeof(ulong)) != 0)
+            throw std::bad_alloc();
+        return (ulong *)p;
+    }
+
+    // Low bit set in each 2-bit field of w equal to the pattern
+    inline ulong match(ulong w, ulong pattern)
+    {
+        ulong x = ~(w ^ pattern);
+        return x & (x >> 1) & LOW_FIELDS;
+    }
+
+    inline ulong superBlocks(ulong nblocks)
+    {
+        return (nblocks + DNARank::SUPER_BLOCKS - 1) / DNARank::SUPER_BLOCKS;
+    }
+}
+
+const uchar DNARank::BASES[4] = {'A', 'C', 'G', 'T'};
+
+/**
+ * Rank for different instruction sets,
+ * instantiated for the Ops classes of BitOps.h
+ */
+struct DNARank::Impl
+{
+    template<class Ops>
+    static inline ulong rank(DNARank const *dr, unsigned code, ulong i)
+    {
+        ulong blk = i / BLOCK_SYMBOLS;
+        unsigned r = i % BLOCK_SYMBOLS;
+        ulong const *b = dr->blocks + blk * BLOCK_WORDS;
+        ulong result = dr->before(code, blk);
+        ulong pattern = code * LOW_FIELDS;
+        unsigned last = r / 32;
+        for (unsigned j = 0; j < last; ++j)
+            result += Ops::popcount(match(b[2 + j], pattern));
+        ulong m = match(b[2 + last], pattern);
+        unsigned bits = 2 * (r % 32) + 2;
+        if (bits < 64)
+            m &= (1lu << bits) - 1;
+        result += Ops::popcount(m);
+
+        // Exceptions are stored as A
+        if (code == 0 && inBlockExceptions(b))
+        {
+            uchar const *o = dr->offsets + dr->before(EXCEPTION, blk);
+            for (unsigned k = inBlockExceptions(b); k && *o <= r; --k, ++o)
+                --result;
+        }
+        return result;
+    }
+
+    template<class Ops>
+    static inline void rankAll(DNARank const *dr, ulong i, ulong *out)
+    {
+        ulong blk = i / BLOCK_SYMBOLS;
+        unsigned r = i % BLOCK_SYMBOLS;
+        ulong const *b = dr->blocks + blk * BLOCK_WORDS;
+        ulong c = 0, g = 0, t = 0;
+        unsigned last = r / 32;
+        for (unsigned j = 0; j <= last; ++j)
+        {
+            ulong w = b[2 + j];
+            if (j == last && r % 32 != 31)
+                w &= (1lu << (2 * (r % 32) + 2)) - 1; // A after position r
+            ulong hi = (w >> 1) & LOW_FIELDS;
+            ulong lo = w & LOW_FIELDS;
+            c += Ops::popcount(lo & ~hi);
+            g += Ops::popcount(hi & ~lo);
+            t += Ops::popcount(hi & lo);
+        }
+        ulong a = r + 1 - c - g - t;
+        if (inBlockExceptions(b))
+        {
+            uchar const *o = dr->offsets + dr->before(EXCEPTION, blk);
+            for (unsigned k = inBlockExceptions(b); k && *o <= r; --k, ++o)
+                --a;
+        }
+        out[0] = dr->before(0, blk) + a;
+        out[1] = dr->before(1, blk) + c;
+        out[2] = dr->before(2, blk) + g;
+        out[3] = dr->before(3, blk) + t;
+    }
+
+    static ulong rankTable(DNARank const *dr, unsigned code, ulong i)
+    { return rank<TableOps>(dr, code, i); }
+    static void rankAllTable(DNARank const *dr, ulong i, ulong *out)
+    { rankAll<TableOps>(dr, i, out); }
+
+#ifdef BITOPS_X86
+    __attribute__((target("popcnt"))) static ulong rankPopcnt(DNARank const *dr, unsigned code, ulong i)
+    { return rank<PopcntOps>(dr, code, i); }
+    __attribute__((target("popcnt"))) static void rankAllPopcnt(DNARank const *dr, ulong i, ulong *out)
+    { rankAll<PopcntOps>(dr, i, out); }
+#endif
+
+    static bool use(std::string const &name)
+    {
+        if (name == "table")
+        {
+            rankFn = rankTable;
+            rankAllFn = rankAllTable;
+            implName = "table";
+            return true;
+        }
+#ifdef BITOPS_X86
+        if ((name == "popcnt" || name == "bmi2") && cpuSupports(name))
+        {
+            rankFn = rankPopcnt; // rank needs only the popcount
+            rankAllFn = rankAllPopcnt;
+            implName = name == "popcnt" ? "popcnt" : "bmi2";
+            return true;
+        }
+#endif
+        return false;
+    }
+
+    // Select the best implementation supported by the CPU
+    static char const * init()
+    {
+        if (!use("popcnt"))
+            use("table");
+        return implName;
+    }
+};
+
+DNARank::rank_fn DNARank::rankFn = DNARank::Impl::rankTable;
+DNARank::rank_all_fn DNARank::rankAllFn = DNARank::Impl::rankAllTable;
+char const *DNARank::implName = DNARank::Impl::init();
+
+bool DNARank::useImplementation(std::string const &name)
+{
+    return Impl::use(name);
+}
+
+DNARank::DNARank()
+    : blocks(0), super(0), offsets(0), exceptions(0), mapped(false)
+{
+    std::memset(&dir, 0, sizeof(Directory));
+}
+
+DNARank::~DNARank()
+{
+    if (!mapped)
+    {
+        std::free(blocks);
+        delete [] super;
+        delete [] offsets;
+    }
+    if (exceptions)
+        HuffWT::deleteHuffWT(exceptions);
+}
+
+/**
+ * Builds the structure from the given sequence of length n.
+ * The sequence is deleted.
+ */
+DNARank * DNARank::makeDNARank(uchar *s, ulong n)
+{
+    DNARank *dr = new DNARank();
+    dr->dir.n = n;
+    for (ulong i = 0; i < n; ++i)
+        dr->dir.count[s[i]]++;
+    for (unsigned c = 0; c < 256; ++c)
+        dr->dir.kind[c] = dr->dir.count[c] ? EXCEPTION : ABSENT;
+    for (unsigned k = 0; k < 4; ++k)
+        dr->dir.kind[BASES[k]] = k;
+
+    ulong nblocks = (n + BLOCK_SYMBOLS - 1) / BLOCK_SYMBOLS;
+    dr->dir.nblocks = nblocks;
+    dr->blocks = allocateBlocks(nblocks * BLOCK_WORDS);
+    std::memset(dr->blocks, 0, nblocks * BLOCK_WORDS * sizeof(ulong));
+    dr->super = new ulong[superBlocks(nblocks) * 4];
+
+    std::vector<uchar> offsets, symbols;
+    ulong count[4] = {0, 0, 0, 0}; // A, C, G and exceptions
+    ulong pos = 0;
+    for (ulong blk = 0; blk < nblocks; ++blk)
+    {
+        ulong *sb = dr->super + (blk / SUPER_BLOCKS) * 4;
+        if (blk % SUPER_BLOCKS == 0)
+            for (unsigned k = 0; k < 4; ++k)
+                sb[k] = count[k];
+        ulong *b = dr->blocks + blk * BLOCK_WORDS;
+        b[0] = (count[0] - sb[0]) | ((count[1] - sb[1]) << 32);
+        b[1] = (count[2] - sb[2]) | ((count[3] - sb[3]) << 32);
+
+        ulong inblock = 0;
+        for (unsigned r = 0; r < BLOCK_SYMBOLS && pos < n; ++r, ++pos)
+        {
+            uchar k = dr->dir.kind[s[pos]];
+            if (k == EXCEPTION)
+            {
+                offsets.push_back(r);
+                symbols.push_back(s[pos]);
+                ++inblock;
+                ++count[3];
+                k = 0; // Stored as A
+            }
+            else if (k < 3)
+                ++count[k];
+            b[2 + r/32] |= (ulong)k << (2 * (r%32));
+        }
+        b[1] |= inblock << 56;
+    }
+    delete [] s;
+
+    dr->dir.nexceptions = symbols.size();
+    dr->offsets = new uchar[offsets.size() + 1];
+    std::copy(offsets.begin(), offsets.end(), dr->offsets);
+    if (!symbols.empty())
+    {
+        std::cerr << "Constructing HuffWT of " << symbols.size() << " exceptions.." << std::endl;
+        uchar *t = new uchar[symbols.size()];
+        std::copy(symbols.begin(), symbols.end(), t);
+        dr->exceptions = HuffWT::makeHuffWT(t, symbols.size());
+    }
+    return dr;
+}
+
+/**
+ * Converts an index built with HuffWT. The tree is deleted.
+ */
+DNARank * DNARank::fromHuffWT(HuffWT *wt, ulong n)
+{
+    std::cerr << "Converting HuffWT to DNARank..." << std::endl;
+    uchar *s = new uchar[n];
+    for (ulong i = 0; i < n; ++i)
+        s[i] = wt->access(i);
+    HuffWT::deleteHuffWT(wt);
+    return makeDNARank(s, n);
+}
+
+void DNARank::rankBatch(uchar const *c, ulong const *i, ulong *out, unsigned k) const
+{
+    for (unsigned j = 0; j < k; ++j)
+        prefetch(i[j]);
+    for (unsigned j = 0; j < k; ++j)
+        out[j] = rank(c[j], i[j]);
+}
+
+void DNARank::rankAllBatch(ulong const *i, ulong *out, unsigned k) const
+{
+    for (unsigned j = 0; j < k; ++j)
+        prefetch(i[j]);
+    for (unsigned j = 0; j < k; ++j)
+        rankAll(i[j], out + 4*j);
+}
+
+ulong DNARank::select(uchar c, ulong j) const
+{
+    uchar k = dir.kind[c];
+    if (k == ABSENT || j == 0 || j > dir.count[c])
+        return ~0lu;
+
+    if (k == EXCEPTION)
+    {
+        // The block of the exception is the last one having at most e exceptions before it
+        ulong e = exceptions->select(c, j);
+        ulong l = 0, r = dir.nblocks - 1;
+        while (l < r)
+        {
+            ulong mid = l + (r - l + 1) / 2;
+            if (before(EXCEPTION, mid) <= e)
+                l = mid;
+            else
+                r = mid - 1;
+        }
+        return l * BLOCK_SYMBOLS + offsets[e];
+    }
+
+    // Binary search for the last block having less than j occurrences before it
+    ulong l = 0, r = dir.nblocks - 1;
+    while (l < r)
+    {
+        ulong mid = l + (r - l + 1) / 2;
+        if (before(k, mid) < j)
+            l = mid;
+        else
+            r = mid - 1;
+    }
+    j -= before(k, l);
+    ulong const *b = blocks + l * BLOCK_WORDS;
+    uchar const *o = offsets + before(EXCEPTION, l);
+    unsigned m = inBlockExceptions(b);
+    for (unsigned i = 0; i < BLOCK_SYMBOLS; ++i)
+    {
+        bool exception = m && *o == i;
+        if (exception)
+        {
+            ++o;
+            --m;
+        }
+        if (!exception && ((b[2 + i/32] >> (2 * (i%32))) & 3) == k && --j == 0)
+            return l * BLOCK_SYMBOLS + i;
+    }
+    throw std::runtime_error("DNARank::select(): invalid count directory.");
+}
+
+/**
+ * Save in the page-aligned layout: the blocks, the superblock counts,
+ * the exception offsets and the exception HuffWT, followed by the
+ * directory (FMIndex v22).
+ *
+ * Returns the file offset of the directory.
+ */
+ulong DNARank::save(DNARank *dr, std::FILE *file)
+{
+    Directory d = dr->dir;
+    d.blocks = MemoryMap::write(file, dr->blocks, d.nblocks * BLOCK_WORDS * sizeof(ulong));
+    d.super = MemoryMap::write(file, dr->super, superBlocks(d.nblocks) * 4 * sizeof(ulong), sizeof(ulong));
+    d.offsets = MemoryMap::write(file, dr->offsets, d.nexceptions, sizeof(ulong));
+    d.wt = 0;
+    if (dr->exceptions)
+        d.wt = HuffWT::save(dr->exceptions, file);
+    return MemoryMap::write(file, &d, sizeof(Directory), sizeof(ulong));
+}
+
+/**
+ * Load the page-aligned layout from the given directory offset.
+ * The arrays are used in place from the mapping unless
+ * a private copy is requested.
+ */
+DNARank * DNARank::load(MemoryMap const &mm, ulong offset, bool copy)
+{
+    DNARank *dr = new DNARank();
+    try
+    {
+        dr->dir = *mm.at<Directory>(offset, 1);
+        Directory const &d = dr->dir;
+        ulong nsuper = superBlocks(d.nblocks);
+        if (d.nblocks != (d.n + BLOCK_SYMBOLS - 1) / BLOCK_SYMBOLS || (d.nexceptions != 0) != (d.wt != 0))
+            throw std::runtime_error("DNARank::load(): invalid directory.");
+        ulong const *blocks = mm.at<ulong>(d.blocks, d.nblocks * BLOCK_WORDS);
+        ulong const *super = mm.at<ulong>(d.super, nsuper * 4);
+        uchar const *offsets = mm.at<uchar>(d.offsets, d.nexceptions);
+        if (copy)
+        {
+            dr->blocks = allocateBlocks(d.nblocks * BLOCK_WORDS);
+            std::memcpy(dr->blocks, blocks, d.nblocks * BLOCK_WORDS * sizeof(ulong));
+            dr->super = new ulong[nsuper * 4];
+            std::memcpy(dr->super, super, nsuper * 4 * sizeof(ulong));
+            dr->offsets = new uchar[d.nexceptions + 1];
+            std::memcpy(dr->offsets, offsets, d.nexceptions);
+        }
+        else
+        {
+            dr->mapped = true;
+            dr->blocks = const_cast<ulong *>(blocks);
+            dr->super = const_cast<ulong *>(super);
+            dr->offsets = const_cast<uchar *>(offsets);
+        }
+        if (d.wt)
+            dr->exceptions = HuffWT::load(mm, d.wt, true, copy);
+    }
+    catch (...)
+    {
+        delete dr;
+        throw;
+    }
+    return dr;
+}
+
+void DNARank::getRegions(std::vector<std::pair<void const *, ulong> > &regions) const
+{
+    regions.push_back(std::make_pair((void const *)blocks, dir.nblocks * BLOCK_WORDS * sizeof(ulong)));
+    regions.push_back(std::make_pair((void const *)super, superBlocks(dir.nblocks) * 4 * sizeof(ulong)));
+    regions.push_back(std::make_pair((void const *)offsets, dir.nexceptions));
+    if (exceptions)
+        exceptions->getRegions(regions);
+}
+
+void DNARank::deleteDNARank(DNARank *dr)
+{
+    delete dr;
+}
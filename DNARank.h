@@ -0,0 +1,225 @@
+/**
+ * Occurrence structure specialized for DNA: a 2-bit packed BWT with
+ * interleaved per-block counts, an alternative to HuffWT.
+ *
+ * The symbols A, C, G and T are stored with 2 bits each in 64 byte
+ * blocks of 8 words: the first two words hold the number of A, C and G
+ * and of the rare symbols before the block (relative to a superblock of
+ * 2^16 blocks), the remaining 6 words hold 192 symbols. The count of T
+ * follows from the block position. Thus rank(c, i) of a base reads one
+ * cache line and needs at most 6 popcounts.
+ *
+ * All other symbols ('\0', '-', 'N', ...) are exceptions: they are
+ * stored as A in the packed array, and the exception list holds their
+ * offsets inside the block in position order. The symbols of the
+ * exceptions are kept in a small HuffWT. The second header word also
+ * holds the number of exceptions inside the block, so that rank of A
+ * reads the exception list only for blocks containing exceptions.
+ *
+ * Interface is the same as in HuffWT; FMIndex uses this class
+ * if compiled with -DDNA_RANK (index version 22).
+ */
+
+#ifndef _DNARANK_H_
+#define _DNARANK_H_
+
+#include "HuffWT.h"
+
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+#include <utility>
+#include <string>
+#include <stdint.h>
+
+class DNARank
+{
+public:
+    static const unsigned BLOCK_WORDS = 8;
+    static const unsigned DATA_WORDS = 6;
+    static const unsigned BLOCK_SYMBOLS = DATA_WORDS * 32;
+    static const ulong SUPER_BLOCKS = 1lu << 16; // relative counts fit in 24 bits
+
+    // Symbol classes in Directory::kind
+    static const uchar EXCEPTION = 4;
+    static const uchar ABSENT = 5;
+
+    /**
+     * Directory in the page-aligned index layout (FMIndex v22).
+     * The arrays and the exception HuffWT precede the directory.
+     */
+    struct Directory
+    {
+        ulong n;
+        ulong nblocks;
+        ulong nexceptions;
+        ulong count[256];
+        ulong blocks;  // file offsets
+        ulong super;
+        ulong offsets;
+        ulong wt;      // HuffWT directory, 0 if there are no exceptions
+        uchar kind[256]; // code 0..3 of A, C, G and T, EXCEPTION or ABSENT
+    };
+
+    static DNARank * makeDNARank(uchar *, ulong);
+    static DNARank * fromHuffWT(HuffWT *, ulong);
+    static DNARank * load(MemoryMap const &, ulong, bool = false);
+    static ulong save(DNARank *, std::FILE *);
+    static void deleteDNARank(DNARank *);
+    void getRegions(std::vector<std::pair<void const *, ulong> > &) const;
+    ~DNARank();
+
+    inline ulong rank(uchar c, ulong i) const // returns the number of characters c before and including position i
+    {
+        uchar k = dir.kind[c];
+        if (i == ~0lu) // LF(c, -1)
+            return 0;
+        if (k < EXCEPTION)
+            return rankFn(this, k, i);
+        if (k == EXCEPTION)
+        {
+            ulong e = exceptionsUpTo(i);
+            return e ? exceptions->rank(c, e-1) : 0;
+        }
+        return 0;
+    }
+
+    /**
+     * rank(c, i) for c = A, C, G and T into out[0..3],
+     * from the same block with one pass over its words.
+     */
+    inline void rankAll(ulong i, ulong *out) const
+    {
+        if (i == ~0lu)
+        {
+            out[0] = out[1] = out[2] = out[3] = 0;
+            return;
+        }
+        rankAllFn(this, i, out);
+    }
+
+    /**
+     * See HuffWT::rankBatch() and HuffWT::rankAllBatch(). There is only
+     * one level: the blocks of all queries are prefetched first.
+     */
+    void rankBatch(uchar const *, ulong const *, ulong *, unsigned) const;
+    void rankAllBatch(ulong const *, ulong *, unsigned) const;
+
+    ulong select(uchar, ulong) const; // position of the i:th c, i >= 1
+
+    inline bool IsCharAtPos(uchar c, ulong i) const
+    {
+        return dir.kind[c] != ABSENT && access(i) == c;
+    }
+
+    inline uchar access(ulong i) const
+    {
+        ulong e;
+        unsigned code = symbolAt(i, e);
+        if (e != NO_EXCEPTION)
+            return exceptions->access(e);
+        return BASES[code];
+    }
+
+    inline uchar access(ulong i, ulong &rank) const
+    {
+        ulong e;
+        unsigned code = symbolAt(i, e);
+        if (e != NO_EXCEPTION)
+            return exceptions->access(e, rank);
+        rank = rankFn(this, code, i);
+        return BASES[code];
+    }
+
+    // See BitRank::implementation()
+    static char const * implementation()
+    { return implName; }
+    static bool useImplementation(std::string const &);
+
+private:
+    static const uchar BASES[4];
+    static const ulong NO_EXCEPTION = ~0lu;
+
+    Directory dir;
+    ulong *blocks;
+    ulong *super;    // counts of A, C, G and exceptions before each superblock
+    uchar *offsets;  // offsets of the exceptions inside their blocks
+    HuffWT *exceptions;
+    bool mapped;     // arrays point inside a MemoryMap
+
+    DNARank();
+
+    // Counts before the block: 0..2 for A, C and G, EXCEPTION for exceptions
+    inline ulong before(unsigned code, ulong blk) const
+    {
+        ulong const *b = blocks + blk * BLOCK_WORDS;
+        ulong const *s = super + (blk / SUPER_BLOCKS) * 4;
+        switch (code)
+        {
+        case 0: return s[0] + (b[0] & 0xffffffffu);
+        case 1: return s[1] + (b[0] >> 32);
+        case 2: return s[2] + (b[1] & 0xffffffffu);
+        case 3: return blk * BLOCK_SYMBOLS - before(0, blk) - before(1, blk) - before(2, blk) - before(EXCEPTION, blk);
+        default: return s[3] + ((b[1] >> 32) & 0xffffff);
+        }
+    }
+
+    inline void prefetch(ulong i) const
+    {
+        if (i != ~0lu)
+        {
+            ulong blk = i / BLOCK_SYMBOLS;
+            __builtin_prefetch(blocks + blk * BLOCK_WORDS);
+            __builtin_prefetch(super + (blk / SUPER_BLOCKS) * 4);
+        }
+    }
+
+    static inline unsigned inBlockExceptions(ulong const *b)
+    {
+        return b[1] >> 56;
+    }
+
+    // Number of exceptions before and including position i
+    inline ulong exceptionsUpTo(ulong i) const
+    {
+        ulong blk = i / BLOCK_SYMBOLS;
+        unsigned r = i % BLOCK_SYMBOLS;
+        ulong e = before(EXCEPTION, blk);
+        unsigned m = inBlockExceptions(blocks + blk * BLOCK_WORDS);
+        for (uchar const *o = offsets + e; m && *o <= r; --m, ++o)
+            ++e;
+        return e;
+    }
+
+    // Code at position i, e is the index of the exception or NO_EXCEPTION
+    inline unsigned symbolAt(ulong i, ulong &e) const
+    {
+        ulong blk = i / BLOCK_SYMBOLS;
+        unsigned r = i % BLOCK_SYMBOLS;
+        ulong const *b = blocks + blk * BLOCK_WORDS;
+        unsigned code = (b[2 + r/32] >> (2 * (r%32))) & 3;
+        e = NO_EXCEPTION;
+        if (code == 0 && inBlockExceptions(b))
+        {
+            ulong k = before(EXCEPTION, blk);
+            for (unsigned m = inBlockExceptions(b); m; --m, ++k)
+                if (offsets[k] == r)
+                    e = k;
+        }
+        return code;
+    }
+
+    // Rank kernels, selected at run time for the CPU
+    struct Impl;
+    typedef ulong (*rank_fn)(DNARank const *, unsigned, ulong);
+    typedef void (*rank_all_fn)(DNARank const *, ulong, ulong *);
+    static rank_fn rankFn;
+    static rank_all_fn rankAllFn;
+    static char const *implName;
+
+    // No copy constructor or assignment
+    DNARank(DNARank const&);
+    DNARank& operator = (DNARank const&);
+};
+
+#endif
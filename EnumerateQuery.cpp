@@ -57,6 +57,56 @@ bool EnumerateQuery::pushChar(char c)
     return true;
 }
 
+/**
+ * Computes the LF-mappings of the current node for all symbols at once,
+ * to be used by pushChar(unsigned, Extensions const &). The interval
+ * ends are independent queries, evaluated in one TextCollection::LFAllBatch.
+ */
+void EnumerateQuery::extensions(Extensions &e) const
+{
+    ulong pos[2 * (ALPHABET_SIZE + 1)];
+    unsigned k = 0;
+    e.row[0] = k;
+    pos[k++] = smin.top()-1;
+    pos[k++] = smax.top();
+    for (unsigned i = 0; i < ALPHABET_SIZE; ++i)
+        if (extmin[i].top() <= extmax[i].top())
+        {
+            e.row[i+1] = k;
+            pos[k++] = extmin[i].top()-1;
+            pos[k++] = extmax[i].top();
+        }
+    tc->LFAllBatch(pos, e.lf[0], k);
+}
+
+/**
+ * Same as pushChar(ALPHABET[k]), using the precomputed LF-mappings
+ */
+bool EnumerateQuery::pushChar(unsigned k, Extensions const &e)
+{
+    ulong nmin = e.lf[e.row[0]][k];
+    ulong nmax = e.lf[e.row[0]+1][k]-1;
+    if (nmin > nmax)
+        return false;
+    smin.push(nmin);
+    smax.push(nmax);
+    match.push_back(ALPHABET[k]);
+
+    for (unsigned i = 0; i < ALPHABET_SIZE; ++i)
+    {
+        nmin = extmin[i].top();
+        nmax = extmax[i].top();
+        if (nmin <= nmax)
+        {
+            nmin = e.lf[e.row[i+1]][k];
+            nmax = e.lf[e.row[i+1]+1][k]-1;
+        }
+        extmin[i].push(nmin); // Push always to keep stacks in sync
+        extmax[i].push(nmax);
+    }
+    return true;
+}
+
 void EnumerateQuery::popChar()
 {
     Query::popChar();
@@ -102,6 +152,78 @@ char EnumerateQuery::leftChar()
     return '0';
 }
 
+/**
+ * Left-char of the reverse complement of the current node, i.e. the
+ * complement of its right-char: the index contains both strands, so
+ * the left extensions of the reverse complement are the complements
+ * of the right extensions of the node.
+ */
+char EnumerateQuery::complementLeftChar() const
+{
+    ulong pos[2] = { smin.top()-1, smax.top() };
+    ulong lf[2][ALPHABET_SIZE];
+    tc->LFAllBatch(pos, lf[0], 2);
+    bool any = false;
+    for (unsigned k = 0; k < ALPHABET_SIZE; ++k)
+        if (lf[0][k] < lf[1][k])
+        {
+            any = true;
+            if (lf[1][k] - lf[0][k] == smax.top() - smin.top() + 1)
+                return Tools::Complement(ALPHABET[k]);
+        }
+    return any ? 'N' : '0';
+}
+
+/**
+ * Children of the reverse complement of the current node, from the
+ * left extensions of the node: '0' if none, the symbol if there is
+ * one, 'N' if there are several.
+ */
+char EnumerateQuery::complementChildren() const
+{
+    if (match.size() >= maxdepth)
+        return '0';
+    char c = '0';
+    for (unsigned i = 0; i < ALPHABET_SIZE; ++i)
+    {
+        ulong nmin = extmin[i].top();
+        ulong nmax = extmax[i].top();
+        if (nmin <= nmax && nmax - nmin + 1 >= fmin)
+            c = c == '0' ? Tools::Complement(ALPHABET[i]) : 'N';
+    }
+    return c;
+}
+
+/**
+ * Writes the end of the current node: frequency, checksum and left-char.
+ *
+ * In canonical mode, a node that is not the canonical strand of its
+ * pair is closed bare: its reverse complement has the same frequency.
+ * A canonical node carries also the left-char and the children of its
+ * reverse complement, so that the server can test both strands.
+ */
+void EnumerateQuery::closeNode(ulong freq)
+{
+    if (canonical && !Tools::IsCanonical(&match[0], match.size()))
+    {
+        cs->putc(')');
+        return;
+    }
+    cs->putulong(freq);
+    if (match.size() <= 6)
+    {
+        cs->putc('R');
+        cs->putulong(reported);
+    }
+    cs->putc(leftChar());
+    if (canonical)
+    {
+        cs->putc(complementLeftChar());
+        cs->putc(complementChildren());
+    }
+    cs->putc(')');
+}
+
 void EnumerateQuery::followOneBranch()
 {
     unsigned i = 0;
@@ -136,14 +258,7 @@ void EnumerateQuery::followOneBranch()
     while (i > 0)
     {
         --i;
-        cs->putulong(1); // Freq.
-        if (match.size() <= 6)
-        {
-            cs->putc('R');
-            cs->putulong(reported);
-        }
-        cs->putc(leftChar());
-        cs->putc(')');
+        closeNode(1);
         popChar();
     }
 }
@@ -181,8 +296,10 @@ void EnumerateQuery::nextSymbol()
         }*/
 
     // ALPHABET has been defined in BTSearch
-    for (const char *c = ALPHABET; c < ALPHABET + ALPHABET_SIZE; ++c) {  /*&& haltDepth > match.size()*/
-	if (!pushChar(*c)) continue;
+    Extensions ext;
+    extensions(ext);
+    for (unsigned k = 0; k < ALPHABET_SIZE; ++k) {  /*&& haltDepth > match.size()*/
+	if (!pushChar(k, ext)) continue;
         if (smax.top() - smin.top() + 1 < fmin)
         {
             popChar();
@@ -209,16 +326,7 @@ void EnumerateQuery::nextSymbol()
         ++reported;        
         nextSymbol();
 
-//        if (smax.top() - smin.top() > 0)
-        cs->putulong(smax.top() - smin.top() + 1);
-        if (match.size() <= 6)
-        {
-            cs->putc('R');
-            cs->putulong(reported);
-        }
-      
-        cs->putc(leftChar());
-        cs->putc(')');
+        closeNode(smax.top() - smin.top() + 1);
 	popChar();
     }
 
@@ -275,16 +383,7 @@ void EnumerateQuery::nextEnforced()
     else
         nextSymbol();
 
-//        if (smax.top() - smin.top() > 0)
-    cs->putulong(smax.top() - smin.top() + 1);
-    if (match.size() <= 6)
-    {
-        cs->putc('R');
-        cs->putulong(reported);
-    }
-    
-    cs->putc(leftChar());
-    cs->putc(')');
+    closeNode(smax.top() - smin.top() + 1);
     popChar();
     //nodeids.pop_back();
 }
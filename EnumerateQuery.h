@@ -12,8 +12,9 @@
 class EnumerateQuery : public Query
 {
 public:
-EnumerateQuery(TextCollection *tc, OutputWriter &ow, bool vrb, ClientSocket *csocket, std::string const &ep, unsigned fm, unsigned md)
-    : Query(tc, ow, vrb, 0, 0, 0), reported(0), cs(csocket), enforcepath(ep), fmin(fm), maxdepth(md) //, haltTo(0), haltDepth(~0u)
+EnumerateQuery(TextCollection *tc, OutputWriter &ow, bool vrb, ClientSocket *csocket, std::string const &ep, unsigned fm, unsigned md,
+               bool cnl = false)
+    : Query(tc, ow, vrb, 0, 0, 0), reported(0), cs(csocket), enforcepath(ep), fmin(fm), maxdepth(md), canonical(cnl) //, haltTo(0), haltDepth(~0u)
     { }
 
     virtual ~EnumerateQuery()
@@ -40,15 +41,33 @@ private:
     TextCollection *tcr; // Index for reversed text
     unsigned fmin; 
     unsigned maxdepth;
+    // Report the nodes of the canonical strands only (see closeNode())
+    bool canonical;
 
     std::stack<ulong> extmin[ALPHABET_SIZE];
     std::stack<ulong> extmax[ALPHABET_SIZE];
 
+    /**
+     * LF-mappings of the current interval (r = 0) and of the non-empty
+     * extended intervals (r = 1..ALPHABET_SIZE) for each symbol of the
+     * alphabet: rows row[r] and row[r]+1 for the start and the end.
+     */
+    struct Extensions
+    {
+        ulong lf[2 * (ALPHABET_SIZE + 1)][ALPHABET_SIZE];
+        unsigned row[ALPHABET_SIZE + 1];
+    };
+    void extensions(Extensions &) const;
+    bool pushChar(unsigned, Extensions const &);
+
 
     /*ulong haltTo;
     unsigned haltDepth;
     std::vector<ulong> nodeids;*/
 
+    char complementLeftChar() const;
+    char complementChildren() const;
+    void closeNode(ulong);
     void followOneBranch();
     void nextSymbol();
     void nextEnforced();
@@ -0,0 +1,86 @@
+#include "ExternalSequence.h"
+
+#include <stdexcept>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <unistd.h>
+#ifdef PARALLEL_SUPPORT
+#include <omp.h>
+#endif
+
+ExternalSequence::ExternalSequence(std::string const &dir, ulong budget)
+    : n(0), ram(budget), inMemory(0)
+{
+    fd[0] = fd[1] = -1;
+    std::memset(counts, 0, sizeof(counts));
+    for (unsigned f = 0; f < 2; ++f)
+    {
+        std::string name = dir + "/builder-bwt-XXXXXX";
+        std::vector<char> tmp(name.begin(), name.end());
+        tmp.push_back(0);
+        fd[f] = mkstemp(&tmp[0]);
+        if (fd[f] == -1)
+        {
+            if (f == 1)
+                close(fd[0]);
+            throw std::runtime_error("ExternalSequence::ExternalSequence(): unable to create a temporary file in " + dir + ".");
+        }
+        unlink(&tmp[0]);
+    }
+
+    // An in-memory subtree needs its symbols, half of them for the
+    // partition and the bit-array: about 1.7 bytes per symbol
+    unsigned threads = 1;
+#ifdef PARALLEL_SUPPORT
+    threads = omp_get_max_threads();
+#endif
+    inMemory = budget / (2 * threads);
+}
+
+ExternalSequence::~ExternalSequence()
+{
+    close(fd[0]);
+    close(fd[1]);
+}
+
+void ExternalSequence::append(uchar const *s, ulong m)
+{
+    for (ulong i = 0; i < m; ++i)
+        counts[s[i]]++;
+    write(0, n, s, m);
+    n += m;
+}
+
+void ExternalSequence::read(unsigned f, ulong from, uchar *buf, ulong m) const
+{
+    while (m > 0)
+    {
+        ssize_t r = pread(fd[f], buf, m, from);
+        if (r <= 0)
+            throw std::runtime_error("ExternalSequence::read(): temporary file read error.");
+        buf += r;
+        from += r;
+        m -= r;
+    }
+}
+
+void ExternalSequence::write(unsigned f, ulong from, uchar const *buf, ulong m) const
+{
+    while (m > 0)
+    {
+        ssize_t r = pwrite(fd[f], buf, m, from);
+        if (r <= 0)
+            throw std::runtime_error("ExternalSequence::write(): temporary file write error (disk full?).");
+        buf += r;
+        from += r;
+        m -= r;
+    }
+}
+
+uchar * ExternalSequence::readAll() const
+{
+    uchar *s = new uchar[n];
+    read(0, 0, s, n);
+    return s;
+}
@@ -0,0 +1,73 @@
+/**
+ * Disk-resident BWT for the external-memory index construction.
+ *
+ * The BWT is streamed from the RLCSA into a temporary file instead of
+ * being materialized in memory, and the wavelet tree is built from the
+ * file (see HuffWT::makeHuffWT()). Each level of the tree partitions
+ * the symbols of its nodes stably into the other one of two temporary
+ * files, at the same offsets as the node, so that the subtrees use
+ * disjoint ranges of the files and can be built in parallel.
+ *
+ * The RAM budget bounds the memory used besides the tree itself:
+ * subtrees whose symbols fit the budget of one thread are read into
+ * memory and built there.
+ *
+ * The temporary files are unlinked when created, so that they
+ * disappear when the builder exits.
+ */
+
+#ifndef _EXTERNALSEQUENCE_H_
+#define _EXTERNALSEQUENCE_H_
+
+#include "Tools.h"
+
+#include <string>
+
+class ExternalSequence
+{
+public:
+    // Size of the disk reads and writes
+    static const ulong IO_BLOCK = 1024*1024;
+    // Default RAM budget
+    static const ulong DEFAULT_BUDGET = 1024lu*1024*1024;
+
+    /**
+     * Create the temporary files in the given directory.
+     *
+     * Throws a std::runtime_error exception if the files can not be created.
+     */
+    ExternalSequence(std::string const &, ulong budget = DEFAULT_BUDGET);
+    ~ExternalSequence();
+
+    // Append symbols to the sequence (file 0)
+    void append(uchar const *, ulong);
+
+    inline ulong length() const
+    { return n; }
+    inline ulong count(uchar c) const
+    { return counts[c]; }
+    inline ulong budget() const
+    { return ram; }
+    // Longest subtree that is built in memory
+    inline ulong memoryLength() const
+    { return inMemory; }
+
+    // Positional reads and writes of the given file (0 or 1), thread-safe
+    void read(unsigned, ulong, uchar *, ulong) const;
+    void write(unsigned, ulong, uchar const *, ulong) const;
+    // The whole sequence in a new array
+    uchar * readAll() const;
+
+private:
+    int fd[2];
+    ulong n;
+    ulong counts[256];
+    ulong ram;
+    ulong inMemory;
+
+    // No copy constructor or assignment
+    ExternalSequence(ExternalSequence const&);
+    ExternalSequence& operator = (ExternalSequence const&);
+};
+
+#endif
@@ -47,8 +47,44 @@ const char FMIndex::ALPHABET_SHIFTED[] = {1, ' '+1, '#'+1,
  * v15 uses ulong C[c], 
  * v16 uses ulong codetable
  * v17 uses BitRank for sampled 
+ * v18 uses a page-aligned layout, HuffWT is memory mapped at load time
+ * v19 is v18 with the cache-line blocked rank directory in HuffWT (BLOCKED_RANK)
+ * v20 adds select hints to HuffWT, the node records identify the rank directory
+ * v21 is v20 with the BWT stored as a WaveletMatrix (WAVELET_MATRIX)
+ * v22 is v20 with the BWT stored as a DNARank (DNA_RANK)
+ * v23 is v20 with the BWT stored as a RunLengthBWT (RUN_LENGTH)
+ * v24-v27 are v20-v23 with a table of the sections and their CRC-32
  */
-const uchar FMIndex::versionFlag = 17;
+#if defined(WAVELET_MATRIX) + defined(DNA_RANK) + defined(RUN_LENGTH) > 1
+#error "Only one of WAVELET_MATRIX, DNA_RANK and RUN_LENGTH can be used"
+#elif defined(WAVELET_MATRIX)
+const uchar FMIndex::versionFlag = 25;
+#elif defined(DNA_RANK)
+const uchar FMIndex::versionFlag = 26;
+#elif defined(RUN_LENGTH)
+const uchar FMIndex::versionFlag = 27;
+#else
+const uchar FMIndex::versionFlag = 24;
+#endif
+
+// Buffer of the index file when saving: the header fields are written in
+// one go, the sections bypass the buffer
+static const ulong SAVE_BUFFER_SIZE = 4*1024*1024;
+
+namespace {
+// Closes the file on an error path, before its buffer is freed
+struct FileCloser
+{
+    std::FILE *file;
+    explicit FileCloser(std::FILE *f)
+        : file(f)
+    { }
+    ~FileCloser()
+    { if (file) std::fclose(file); }
+    std::FILE * release()
+    { std::FILE *f = file; file = 0; return f; }
+};
+}
 
 /**
  * Given suffix i and substring length l, return T[SA[i] ... SA[i]+l].
@@ -94,7 +130,7 @@ FMIndex::FMIndex(uchar * bwt, ulong length, unsigned samplerate_, unsigned numbe
                  bool storePlainText, bool colorCoded_, unsigned rotationLength_)
     : TextCollection(colorCoded_, rotationLength_), n(length), samplerate(samplerate_), bwtEndPos(0), alphabetrank(0), 
       sampled(0), suffixes(0), suffixDocId(0), numberOfTexts(numberOfTexts_), maxTextLength(maxTextLength_), Doc(0), 
-      textStorage(0), name(0), textLength(0)
+      textStorage(0), name(0), textLength(0), mapping(0)
 {
     assert(!(rotationLength && storePlainText));
 /*    if (name_.size())   FIXME disabled
@@ -122,6 +158,17 @@ FMIndex::FMIndex(uchar * bwt, ulong length, unsigned samplerate_, unsigned numbe
     //maketables(numberOfSamples_, storePlainText);
 }
 
+FMIndex::FMIndex(ExternalSequence const &bwt, unsigned samplerate_, unsigned numberOfTexts_, 
+                 ulong maxTextLength_, ulong, vector<std::string> &,
+                 bool storePlainText, bool colorCoded_, unsigned rotationLength_)
+    : TextCollection(colorCoded_, rotationLength_), n(bwt.length()), samplerate(samplerate_), bwtEndPos(0), alphabetrank(0), 
+      sampled(0), suffixes(0), suffixDocId(0), numberOfTexts(numberOfTexts_), maxTextLength(maxTextLength_), Doc(0), 
+      textStorage(0), name(0), textLength(0), mapping(0)
+{
+    assert(!(rotationLength && storePlainText));
+    makewavelet(bwt);
+}
+
 void FMIndex::saveSamples(std::string const & filename)
 {
 //    makesamples();
@@ -151,11 +198,21 @@ void FMIndex::saveSamples(std::string const & filename)
  *
  * Throws a std::runtime_error exception on i/o error.
  * First byte that is saved represents the version number of the save file.
+ *
+ * The header fields are followed by the page-aligned sections of the
+ * BWT (see MemoryMap::write()) and the table of the sections, the
+ * header being the first one. The offsets of the BWT directory and
+ * of the table are filled into the header last.
  */
 void FMIndex::save(std::string const & filename) const
 {
     std::string name = filename + TextCollection::FMINDEX_EXTENSION;
-    std::FILE *file = std::fopen(name.c_str(), "wb");
+    std::FILE *file = std::fopen(name.c_str(), "w+b"); // The header is read back for its CRC
+    if (file == NULL)
+        throw std::runtime_error("FMIndex::save(): unable to open " + name + ".");
+    std::vector<char> buffer(SAVE_BUFFER_SIZE);
+    FileCloser closer(file); // Declared after the buffer, so it is closed first
+    std::setvbuf(file, &buffer[0], _IOFBF, buffer.size());
 
 
     // Saving version info:
@@ -173,8 +230,15 @@ void FMIndex::save(std::string const & filename) const
     if (std::fwrite(&(this->bwtEndPos), sizeof(TextPosition), 1, file) != 1)
         throw std::runtime_error("FMIndex::save(): file write error (bwt end position).");
         
-//    alphabetrank->save(file);
-    HuffWT::save(alphabetrank, file);
+    // Offset of the HuffWT directory is not known until the tree has been
+    // written after the other fields; reserve space for it here.
+    long wtOffsetPos = std::ftell(file);
+    ulong wtOffset = 0;
+    if (std::fwrite(&wtOffset, sizeof(ulong), 1, file) != 1)
+        throw std::runtime_error("FMIndex::save(): file write error (HuffWT offset).");
+    ulong tableOffset = 0;
+    if (std::fwrite(&tableOffset, sizeof(ulong), 1, file) != 1)
+        throw std::runtime_error("FMIndex::save(): file write error (section table offset).");
 
     if (suffixDocId)
         suffixDocId->Save(file);
@@ -212,8 +276,44 @@ void FMIndex::save(std::string const & filename) const
     if (std::fwrite(&rotationLength, sizeof(unsigned), 1, file) != 1)
         throw std::runtime_error("FMIndex::save(): file write error (rotation length).");
 
-    fflush(file);
-    std::fclose(file);
+    // Page-aligned bit-arrays and the tree directory
+    long headerEnd = std::ftell(file);
+    std::vector<MemoryMap::Section> sections(1); // sections[0] is the header
+    MemoryMap::recordSections(&sections);
+    try
+    {
+        wtOffset = BWTSequence::save(alphabetrank, file);
+    }
+    catch (...)
+    {
+        MemoryMap::recordSections(0);
+        throw;
+    }
+    MemoryMap::recordSections(0);
+    long end = std::ftell(file);
+    tableOffset = (end + sizeof(ulong) - 1) / sizeof(ulong) * sizeof(ulong);
+
+    if (std::fseek(file, wtOffsetPos, SEEK_SET) != 0)
+        throw std::runtime_error("FMIndex::save(): file seek error (HuffWT offset).");
+    if (std::fwrite(&wtOffset, sizeof(ulong), 1, file) != 1)
+        throw std::runtime_error("FMIndex::save(): file write error (HuffWT offset).");
+    if (std::fwrite(&tableOffset, sizeof(ulong), 1, file) != 1)
+        throw std::runtime_error("FMIndex::save(): file write error (section table offset).");
+
+    std::vector<uchar> header(headerEnd);
+    if (std::fflush(file) != 0 || std::fseek(file, 0, SEEK_SET) != 0
+        || std::fread(&header[0], 1, headerEnd, file) != (ulong)headerEnd)
+        throw std::runtime_error("FMIndex::save(): file read error (header).");
+    sections[0].offset = 0;
+    sections[0].length = headerEnd;
+    sections[0].crc = MemoryMap::crc(&header[0], headerEnd);
+    if (std::fseek(file, end, SEEK_SET) != 0)
+        throw std::runtime_error("FMIndex::save(): file seek error (section table).");
+    if (MemoryMap::writeSections(file, sections) != tableOffset)
+        throw std::runtime_error("FMIndex::save(): file write error (section table).");
+
+    if (std::fclose(closer.release()) != 0)
+        throw std::runtime_error("FMIndex::save(): file write error.");
 }
 
 void FMIndex::recomputeC()
@@ -242,10 +342,10 @@ void FMIndex::recomputeC()
  * Throws a std::runtime_error exception on i/o error.
  * For more info, see FMIndex::save().
  */
-FMIndex::FMIndex(std::string const & filename, std::string const & samplefile = "")
+FMIndex::FMIndex(std::string const & filename, std::string const & samplefile, MemoryMode mode, bool verify)
     : n(0), samplerate(0), alphabetrank(0), sampled(0), suffixes(0), 
       suffixDocId(0), numberOfTexts(0), maxTextLength(0), Doc(0), 
-      textStorage(0), name(0), textLength(0)
+      textStorage(0), name(0), textLength(0), mapping(0)
 {
     std::string name = filename + TextCollection::FMINDEX_EXTENSION;
     std::FILE *file = std::fopen(name.c_str(), "rb");
@@ -264,8 +364,26 @@ FMIndex::FMIndex(std::string const & filename, std::string const & samplefile =
     uchar verFlag = 0;
     if (std::fread(&verFlag, 1, 1, file) != 1)
         throw std::runtime_error("file read error: incorrect version flag! Please reconstruct the index");
-    if (verFlag != FMIndex::versionFlag && verFlag != 15 && verFlag != 14 && verFlag != 16)
+    if (verFlag < 14 || verFlag > 27)
         throw std::runtime_error("FMIndex::FMIndex(): invalid save file version.");
+    // Layout of the BWT: v24-v27 are v20-v23 with the section table
+    uchar layout = verFlag >= 24 ? verFlag - 4 : verFlag;
+#ifndef BLOCKED_RANK
+    if (layout == 19)
+        throw std::runtime_error("FMIndex::FMIndex(): index version 19 requires compiling with -DBLOCKED_RANK.");
+#endif
+#ifndef WAVELET_MATRIX
+    if (layout == 21)
+        throw std::runtime_error("FMIndex::FMIndex(): index versions 21 and 25 require compiling with -DWAVELET_MATRIX.");
+#endif
+#ifndef DNA_RANK
+    if (layout == 22)
+        throw std::runtime_error("FMIndex::FMIndex(): index versions 22 and 26 require compiling with -DDNA_RANK.");
+#endif
+#ifndef RUN_LENGTH
+    if (layout == 23)
+        throw std::runtime_error("FMIndex::FMIndex(): index versions 23 and 27 require compiling with -DRUN_LENGTH.");
+#endif
 //    cerr << "verFlag = " << (int)verFlag << endl;
     if (std::fread(&(this->n), sizeof(TextPosition), 1, file) != 1)
         throw std::runtime_error("FMIndex::FMIndex(): file read error (n).");
@@ -293,8 +411,22 @@ FMIndex::FMIndex(std::string const & filename, std::string const & samplefile =
     if (std::fread(&(this->bwtEndPos), sizeof(TextPosition), 1, file) != 1)
         throw std::runtime_error("FMIndex::FMIndex(): file read error (bwt end position).");
 
-    //alphabetrank = static_sequence::load(file);
-    alphabetrank = HuffWT::load(file, verFlag);
+    ulong wtOffset = 0;
+    ulong tableOffset = 0;
+    if (verFlag >= 18)
+    {
+        if (std::fread(&wtOffset, sizeof(ulong), 1, file) != 1)
+            throw std::runtime_error("FMIndex::FMIndex(): file read error (HuffWT offset).");
+        if (verFlag >= 24 && std::fread(&tableOffset, sizeof(ulong), 1, file) != 1)
+            throw std::runtime_error("FMIndex::FMIndex(): file read error (section table offset).");
+    }
+    else
+        //alphabetrank = static_sequence::load(file);
+#if defined(WAVELET_MATRIX) || defined(DNA_RANK) || defined(RUN_LENGTH)
+        alphabetrank = BWTSequence::fromHuffWT(HuffWT::load(file, verFlag), n);
+#else
+        alphabetrank = HuffWT::load(file, verFlag);
+#endif
 
     if (safile)
     {
@@ -339,6 +471,38 @@ FMIndex::FMIndex(std::string const & filename, std::string const & samplefile =
     assert(!(this->textStorage && rotationLength));
 
     std::fclose(file);
+
+    if (verFlag >= 18)
+    {
+        // Bit-arrays are used in place, only the tree nodes are allocated
+        mapping = new MemoryMap(filename + TextCollection::FMINDEX_EXTENSION, mode == MEMORY_HUGEPAGES);
+        if (verify && verFlag >= 24)
+        {
+            try
+            {
+                mapping->verifySections(tableOffset);
+            }
+            catch (...)
+            {
+                delete mapping;
+                mapping = 0;
+                throw;
+            }
+        }
+#if defined(WAVELET_MATRIX) || defined(DNA_RANK) || defined(RUN_LENGTH)
+        if (layout <= 20)
+            alphabetrank = BWTSequence::fromHuffWT(HuffWT::load(*mapping, wtOffset, layout >= 20), n);
+        else
+            alphabetrank = BWTSequence::load(*mapping, wtOffset, mode == MEMORY_COPY);
+#else
+        alphabetrank = HuffWT::load(*mapping, wtOffset, layout >= 20, mode == MEMORY_COPY);
+#endif
+        if (mode == MEMORY_COPY)
+        {
+            delete mapping;
+            mapping = 0;
+        }
+    }
     // FIXME Construct data structures with new samplerate
     //maketables(); 
 
@@ -382,7 +546,16 @@ ulong FMIndex::Search(uchar const * pattern, TextPosition m, TextPosition *spRes
 
 
 FMIndex::~FMIndex() {
+#if defined(WAVELET_MATRIX)
+    WaveletMatrix::deleteWaveletMatrix(alphabetrank);
+#elif defined(DNA_RANK)
+    DNARank::deleteDNARank(alphabetrank);
+#elif defined(RUN_LENGTH)
+    RunLengthBWT::deleteRunLengthBWT(alphabetrank);
+#else
     HuffWT::deleteHuffWT(alphabetrank);
+#endif
+    delete mapping; // after alphabetrank
     delete sampled;
     delete suffixes;
     delete suffixDocId;
@@ -417,13 +590,115 @@ void FMIndex::makewavelet(uchar *bwt)
 */
 
 
+#if defined(WAVELET_MATRIX)
+    std::cerr << "Constructing WaveletMatrix.." << std::endl;
+    alphabetrank = WaveletMatrix::makeWaveletMatrix(bwt, n);
+#elif defined(DNA_RANK)
+    std::cerr << "Constructing DNARank.." << std::endl;
+    alphabetrank = DNARank::makeDNARank(bwt, n);
+#elif defined(RUN_LENGTH)
+    std::cerr << "Constructing RunLengthBWT.." << std::endl;
+    alphabetrank = RunLengthBWT::makeRunLengthBWT(bwt, n);
+#else
     std::cerr << "Constructing HuffWT.." << std::endl;
     alphabetrank = HuffWT::makeHuffWT(bwt, n);
+#endif
     std::cerr << "Done." << std::endl;
 //    delete [] bwt; // Was deleted
     bwt = 0;
 }
 
+/**
+ * The suffixes of each text of b are searched backwards in both
+ * indexes at the same time: a suffix at row q of b that has r smaller
+ * suffixes in a is at row q + r of the merged BWT. The end-markers of b
+ * sort after those of a. The work is proportional to the texts of b,
+ * besides one scan over the BWT of a to write the merged one.
+ */
+uchar * FMIndex::mergeBWT(FMIndex const *a, FMIndex const *b, ExternalSequence *ext, vector<bool> *fromB)
+{
+    ulong const WORD_BITS = 8*sizeof(ulong); // W is redefined by libcds
+    ulong total = a->n + b->n;
+
+    // Rows of the suffixes of b in the merged BWT
+    cerr << "merging the BWTs of " << a->numberOfTexts << " and " << b->numberOfTexts << " texts.." << endl;
+    ulong words = total/WORD_BITS + 1;
+    ulong *isB = new ulong[words];
+    for (ulong i = 0; i < words; ++i)
+        isB[i] = 0;
+    ulong marked = 0;
+#ifdef PARALLEL_SUPPORT
+    #pragma omp parallel for schedule(dynamic, 256) reduction(+:marked)
+#endif
+    for (long t = 0; t < (long)b->numberOfTexts; ++t)
+    {
+        ulong q = t, r = a->numberOfTexts;
+        while (true)
+        {
+            ulong p = q + r;
+            __sync_fetch_and_or(isB + p/WORD_BITS, 1lu << (p % WORD_BITS));
+            ++marked;
+            ulong rank = 0;
+            uchar c = b->alphabetrank->access(q, rank);
+            if (c == 0)
+                break;
+            q = b->C[c] + rank - 1;
+            r = a->C[c] + a->alphabetrank->rank(c, r - 1);
+        }
+    }
+    if (marked != b->n)
+    {
+        delete [] isB;
+        throw std::runtime_error("FMIndex::mergeBWT(): invalid BWT, the texts do not match the end-markers.");
+    }
+
+    // Interleave the two BWTs, in pieces of half the RAM budget if external
+    ulong piece = ext ? ext->budget() / 2 + 1 : total;
+    if (piece > total)
+        piece = total;
+    uchar *out = new uchar[piece];
+    ulong q = 0, g = 0, m = 0;
+    for (ulong p = 0; p < total; ++p)
+    {
+        bool inB = isB[p/WORD_BITS] & (1lu << (p % WORD_BITS));
+        uchar c = inB ? b->alphabetrank->access(q++) : a->alphabetrank->access(g++);
+        out[m++] = c;
+        if (c == 0 && fromB)
+            fromB->push_back(inB);
+        if (ext && (m == piece || p == total - 1))
+        {
+            ext->append(out, m);
+            m = 0;
+        }
+    }
+    delete [] isB;
+    if (ext)
+    {
+        delete [] out;
+        out = 0;
+    }
+    return out;
+}
+
+/**
+ * Only the wavelet tree is built from disk,
+ * the other sequences read the BWT into memory.
+ */
+void FMIndex::makewavelet(ExternalSequence const &bwt)
+{
+#if defined(WAVELET_MATRIX) || defined(DNA_RANK) || defined(RUN_LENGTH)
+    makewavelet(bwt.readAll());
+#else
+    C[0] = 0;
+    for (unsigned i = 1; i < 256; ++i)
+        C[i] = C[i-1] + bwt.count(i-1);
+
+    std::cerr << "Constructing HuffWT.." << std::endl;
+    alphabetrank = HuffWT::makeHuffWT(bwt);
+    std::cerr << "Done." << std::endl;
+#endif
+}
+
 unsigned FMIndex::outputReads(ResultSet *results)
 {
     // Calculate BWT end-marker position (of last inserted text)
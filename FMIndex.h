@@ -24,9 +24,14 @@
 #include "TextCollection.h"
 #include "BlockArray.h"
 #include "ArrayDoc.h"
+#include "SampleMap.h"
 #include "TextStorage.h"
 #include "HuffWT.h"
+#include "WaveletMatrix.h"
+#include "DNARank.h"
+#include "RunLengthBWT.h"
 #include "ResultSet.h"
+#include "MemoryMap.h"
 
 // Include  from XMLTree/libcds
 #include <basics.h> // Defines W == 32
@@ -69,9 +74,26 @@ public:
     { return n; }
     DocId getNumberOfTexts() const
     { return numberOfTexts; }
+    // Length of the longest text (including the 0-terminator)
+    ulong getMaxTextLength() const
+    { return maxTextLength; }
+    unsigned getSamplerate() const
+    { return samplerate; }
+
+    /**
+     * BWT of the texts of a followed by the texts of b, in the order
+     * of a rebuild from both inputs. Written to the external sequence
+     * if one is given (returns 0). If fromB is given, it receives for
+     * each end-marker of the merged BWT whether it comes from b.
+     */
+    static uchar * mergeBWT(FMIndex const *a, FMIndex const *b, ExternalSequence *ext = 0,
+                            std::vector<bool> *fromB = 0);
 
     unsigned outputReads(ResultSet *);
 
+    void getRegions(region_vector &regions) const
+    { alphabetrank->getRegions(regions); }
+
     /**
      * Return lenght of i'th text (excluding 0-terminators).
      *
@@ -89,6 +111,41 @@ public:
         return C[(int)c] + alphabetrank->rank(c, i);
     } 
 
+    // LF(c, i) for c = A, C, G and T, with one traversal of alphabetrank
+    inline void LFAll(TextPosition i, TextPosition *out) const
+    {
+        alphabetrank->rankAll(i, out);
+        out[0] += C[(int)'A'];
+        out[1] += C[(int)'C'];
+        out[2] += C[(int)'G'];
+        out[3] += C[(int)'T'];
+    }
+
+    /**
+     * LF(c[j], i[j]) for j < k. The rank queries advance through
+     * alphabetrank in lockstep with prefetching, so that their
+     * cache misses overlap (see HuffWT::rankBatch()).
+     */
+    inline void LFBatch(uchar const *c, TextPosition const *i, TextPosition *out, unsigned k) const
+    {
+        alphabetrank->rankBatch(c, i, out, k);
+        for (unsigned j = 0; j < k; ++j)
+            out[j] += C[(int)c[j]];
+    }
+
+    // LFAll(i[j], out + 4*j) for j < k, in lockstep as above
+    inline void LFAllBatch(TextPosition const *i, TextPosition *out, unsigned k) const
+    {
+        alphabetrank->rankAllBatch(i, out, k);
+        for (unsigned j = 0; j < 4*k; j += 4)
+        {
+            out[j] += C[(int)'A'];
+            out[j+1] += C[(int)'C'];
+            out[j+2] += C[(int)'G'];
+            out[j+3] += C[(int)'T'];
+        }
+    }
+
     /**
      * Given suffix i and substring length l, return T[SA[i] ... SA[i]+l].
      *
@@ -154,6 +211,28 @@ public:
     }
 
 
+    /**
+     * Number of suffixes in [sp, ep] from each sample of a pooled index
+     * (see indexmerge): each suffix is followed backwards to the start
+     * of its text, so the work is proportional to the text lengths.
+     */
+    inline void countPerSample(SampleMap &samples, TextPosition sp, TextPosition ep, std::vector<ulong> &result) const
+    {
+        result.assign(samples.numberOfSamples(), 0);
+        ulong tmp_rank_c = 0; // Cache rank value of c.
+        for (; sp <= ep; ++sp)
+        {
+            TextPosition i = sp;
+            uchar c = alphabetrank->access(i, tmp_rank_c);
+            while (c != '\0')
+            {
+                i = C[c]+tmp_rank_c-1;
+                c = alphabetrank->access(i, tmp_rank_c);
+            }
+            result[samples.sample(tmp_rank_c-1)]++;
+        }
+    }
+
     /**
      * Extracting one text.
      *
@@ -170,8 +249,11 @@ public:
 
     FMIndex(uchar *, ulong, unsigned, unsigned, ulong, ulong, std::vector<std::string> &,
             bool, bool, unsigned = 0);
-    // Index from/to disk
-    FMIndex(std::string const &, std::string const &);
+    // From a disk-resident BWT (external-memory construction)
+    FMIndex(ExternalSequence const &, unsigned, unsigned, ulong, ulong, std::vector<std::string> &,
+            bool, bool, unsigned = 0);
+    // Index from/to disk, the sections are checked if verify is set
+    FMIndex(std::string const &, std::string const &, MemoryMode = MEMORY_MAPPED, bool verify = false);
     void save(std::string const &) const;
     void saveSamples(std::string const &);
     ~FMIndex();
@@ -186,7 +268,17 @@ private:
     ulong C[256];
     TextPosition bwtEndPos;
     //static_sequence * alphabetrank;
-    HuffWT *alphabetrank;
+    // Representation of the BWT, selected at build time
+#if defined(WAVELET_MATRIX)
+    typedef WaveletMatrix BWTSequence;
+#elif defined(DNA_RANK)
+    typedef DNARank BWTSequence;
+#elif defined(RUN_LENGTH)
+    typedef RunLengthBWT BWTSequence;
+#else
+    typedef HuffWT BWTSequence;
+#endif
+    BWTSequence *alphabetrank;
 
     // Sample structures for texts longer than samplerate
     //static_bitsequence * sampled;
@@ -210,10 +302,14 @@ private:
     // Array of text lengths, FIXME using too much mem?
     BlockArray *textLength;
 
+    // Index file mapping (v18 and later), owns the bit-arrays of alphabetrank
+    MemoryMap *mapping;
+
     // Following methods are not part of the public API
     uchar * BWT(uchar *);
     void recomputeC();
     void makewavelet(uchar *);
+    void makewavelet(ExternalSequence const &);
     void maketables(ulong, bool);
     void makesamples();
     ulong Search(uchar const *, TextPosition, TextPosition *, TextPosition *) const;
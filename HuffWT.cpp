@@ -1,61 +1,273 @@
 #include "HuffWT.h"
 #include <queue>
 #include <vector>
+#include <string>
+#include <cstring>
 
+namespace {
+// An exception cannot leave an OpenMP task or parallel region: the
+// first error of the subtrees is recorded and rethrown after the wait
+void recordError(std::string &error, std::exception const &e)
+{
+#ifdef PARALLEL_SUPPORT
+    #pragma omp critical (HUFFWT_ERROR)
+#endif
+    if (error.empty())
+        error = e.what();
+}
+}
+
+/**
+ * Builds the node of s[0..n-1]. The symbols are partitioned in place
+ * (stable, 0-bits first) and the subtrees are built on the two parts;
+ * s is deleted by the caller (see makeHuffWT()).
+ */
 HuffWT::HuffWT(uchar *s, ulong n, TCodeEntry *codetable, unsigned level) 
-    :bitrank(0), left(0), right(0), codetable(0), ch(0), leaf(0)
+    :left(0), right(0), codetable(0), ch(0), leaf(0)
 {
     ch = s[0];
     leaf = false;
     this->codetable = codetable;
     
+#ifdef PARALLEL_SUPPORT
+    #pragma omp critical (HUFFWT_LOG)
+#endif
     std::cerr << "Constructing huff tree at level " << level <<  std::endl;
-    ulong *B = new ulong[n/W+1];
-    for (ulong i = 0; i < n/W+1; ++i)
-        B[i] = 0;
-    ulong sum=0,i;
-
-    /*
-      for (i=0; i< n; i++) {
-      printf("%c:", (char)((int)s[i]-128));
-      for (r=0;r<codetable[(int)s[i]].bits;r++)
-      if (codetable[(int)s[i]].code & (1u <<r))
-      printf("1");
-      else printf("0");
-      printf("\n");	  
-      }
-      printf("\n");
-      if (level > 100) return;*/
-
-    for (i=0;i<n;i++) 
-        if (codetable[(int)s[i]].code & (1u << level)) {
-            Tools::SetField(B, 1, i, 1);
-            sum++;
-        }
+    uchar bit[256];
+    for (unsigned c = 0; c < 256; ++c)
+        bit[c] = (codetable[c].code & (1u << level)) != 0;
+
+    // Fill the bit-array a word at a time
+    ulong words = n/W+1;
+    ulong *B = new ulong[words];
+#ifdef PARALLEL_SUPPORT
+    #pragma omp taskloop shared(bit) grainsize(PARALLEL_MIN_LENGTH/W) if (n >= PARALLEL_MIN_LENGTH)
+#endif
+    for (ulong w = 0; w < words; ++w)
+    {
+        ulong i = w*W;
+        ulong end = i + W < n ? i + W : n;
+        ulong x = 0;
+        for (unsigned k = 0; i < end; ++i, ++k)
+            x |= (ulong)bit[s[i]] << k;
+        B[w] = x;
+    }
+    ulong sum = 0;
+    for (ulong w = 0; w < words; ++w)
+        sum += __builtin_popcountl(B[w]);
     if (sum==0 || sum==n) {
         delete [] B;
-        delete [] s;
 	leaf = true;
         return;
     } 
-    uchar *sfirst, *ssecond;
-    sfirst = new uchar[n-sum];
-    ssecond = new uchar[sum];
-    ulong j=0,k=0;
-    for (i=0;i<n;i++)
-        if (Tools::GetField(B,1,i)) ssecond[k++] = s[i];
-        else sfirst[j++] = s[i];
-    delete [] s; s = 0;
-
-    bitrank = new BitRank(B,n,true);
-    left = new HuffWT(sfirst,j,codetable,level+1); 
-    sfirst = 0; // Was deleted
-    right = new HuffWT(ssecond,k,codetable,level+1); 
-    ssecond = 0; // Was deleted
+
+    // Stable partition: the larger part is compacted inside s and only
+    // the smaller part is copied through a temporary array. The stores
+    // are branchless, a store that is not counted is overwritten later.
+    ulong j = n-sum;
+    if (sum <= j)
+    {
+        uchar *t = new uchar[sum+1];
+        ulong z = 0, o = 0;
+        for (ulong i = 0; i < n; ++i)
+        {
+            uchar c = s[i];
+            s[z] = c;
+            t[o] = c;
+            o += bit[c];
+            z += 1 - bit[c];
+        }
+        std::memcpy(s + j, t, sum);
+        delete [] t;
+    }
+    else
+    {
+        uchar *t = new uchar[j+1]; // 0-bits into t[1..j]
+        ulong z = j, o = n;
+        for (ulong i = n; i-- > 0; )
+        {
+            uchar c = s[i];
+            s[o-1] = c;
+            t[z] = c;
+            o -= bit[c];
+            z -= 1 - bit[c];
+        }
+        std::memcpy(s, t + 1, j);
+        delete [] t;
+    }
+
+    bitrank.build(B,n,sum);
+    if (bitrank.encoding() != NodeBitVector::ENCODING_PLAIN)
+    {
+#ifdef PARALLEL_SUPPORT
+        #pragma omp critical (HUFFWT_LOG)
+#endif
+        std::cerr << "Node of " << n << " bits with " << sum << " 1-bits at level " << level << ": "
+                  << NodeBitVector::encodingName(bitrank.encoding()) << " encoding, "
+                  << bitrank.compressedSize() << " bytes" << std::endl;
+    }
+
+    // The subtrees are independent, the left one is built by another thread (see makeHuffWT())
+    std::string error;
+#ifdef PARALLEL_SUPPORT
+    #pragma omp task shared(error) if (j >= PARALLEL_MIN_LENGTH)
+#endif
+    try
+    {
+        left = new HuffWT(s,j,codetable,level+1);
+    }
+    catch (std::exception const &e)
+    {
+        recordError(error, e);
+    }
+    try
+    {
+        right = new HuffWT(s+j,sum,codetable,level+1);
+    }
+    catch (std::exception const &e)
+    {
+        recordError(error, e);
+    }
+#ifdef PARALLEL_SUPPORT
+    #pragma omp taskwait
+#endif
+    if (!error.empty())
+    {
+        delete left;
+        delete right;
+        throw std::runtime_error(error);
+    }
+}
+
+/**
+ * Builds the node of the symbols s[from..from+n-1] on disk: the
+ * bit-array is filled by one scan over the file of this level, and a
+ * second scan partitions the symbols into the other file at the same
+ * offsets (0-bits first) for the subtrees.
+ */
+HuffWT::HuffWT(ExternalSequence const &s, ulong from, ulong n, TCodeEntry *codetable, unsigned level)
+    :left(0), right(0), codetable(0), ch(0), leaf(0)
+{
+    leaf = false;
+    this->codetable = codetable;
+
+#ifdef PARALLEL_SUPPORT
+    #pragma omp critical (HUFFWT_LOG)
+#endif
+    std::cerr << "Constructing huff tree at level " << level << " from disk (" << n << " symbols)" << std::endl;
+    uchar bit[256];
+    for (unsigned c = 0; c < 256; ++c)
+        bit[c] = (codetable[c].code & (1u << level)) != 0;
+
+    unsigned f = level % 2;
+    ulong const block = ExternalSequence::IO_BLOCK; // a multiple of W
+    uchar *buf = new uchar[block];
+    ulong *B = new ulong[n/W+1];
+    B[n/W] = 0;
+    for (ulong p = 0; p < n; p += block)
+    {
+        ulong m = n - p < block ? n - p : block;
+        s.read(f, from + p, buf, m);
+        if (p == 0)
+            ch = buf[0];
+        for (ulong i = 0; i < m; i += W)
+        {
+            ulong end = i + W < m ? i + W : m;
+            ulong x = 0;
+            for (unsigned k = 0; i + k < end; ++k)
+                x |= (ulong)bit[buf[i + k]] << k;
+            B[(p + i)/W] = x;
+        }
+    }
+    ulong sum = 0;
+    for (ulong w = 0; w < n/W+1; ++w)
+        sum += __builtin_popcountl(B[w]);
+    if (sum==0 || sum==n) {
+        delete [] B;
+        delete [] buf;
+        leaf = true;
+        return;
+    }
+
+    ulong j = n-sum;
+    uchar *zeros = new uchar[block];
+    uchar *ones = new uchar[block];
+    ulong z = 0, o = 0, zpos = from, opos = from + j;
+    for (ulong p = 0; p < n; p += block)
+    {
+        ulong m = n - p < block ? n - p : block;
+        s.read(f, from + p, buf, m);
+        for (ulong i = 0; i < m; ++i)
+        {
+            uchar c = buf[i];
+            zeros[z] = c;
+            ones[o] = c;
+            z += 1 - bit[c];
+            o += bit[c];
+            if (z == block)
+            {
+                s.write(1 - f, zpos, zeros, z);
+                zpos += z;
+                z = 0;
+            }
+            if (o == block)
+            {
+                s.write(1 - f, opos, ones, o);
+                opos += o;
+                o = 0;
+            }
+        }
+    }
+    s.write(1 - f, zpos, zeros, z);
+    s.write(1 - f, opos, ones, o);
+    delete [] zeros;
+    delete [] ones;
+    delete [] buf;
+
+    bitrank.build(B,n,sum);
+    if (bitrank.encoding() != NodeBitVector::ENCODING_PLAIN)
+    {
+#ifdef PARALLEL_SUPPORT
+        #pragma omp critical (HUFFWT_LOG)
+#endif
+        std::cerr << "Node of " << n << " bits with " << sum << " 1-bits at level " << level << ": "
+                  << NodeBitVector::encodingName(bitrank.encoding()) << " encoding, "
+                  << bitrank.compressedSize() << " bytes" << std::endl;
+    }
+
+    std::string error;
+#ifdef PARALLEL_SUPPORT
+    #pragma omp task shared(s, error)
+#endif
+    try
+    {
+        left = makeNode(s, from, j, codetable, level+1);
+    }
+    catch (std::exception const &e)
+    {
+        recordError(error, e);
+    }
+    try
+    {
+        right = makeNode(s, from + j, sum, codetable, level+1);
+    }
+    catch (std::exception const &e)
+    {
+        recordError(error, e);
+    }
+#ifdef PARALLEL_SUPPORT
+    #pragma omp taskwait
+#endif
+    if (!error.empty())
+    {
+        delete left;
+        delete right;
+        throw std::runtime_error(error);
+    }
 }
 
 HuffWT::HuffWT(std::FILE *file, TCodeEntry *ct)
-    :bitrank(0), left(0), right(0), codetable(ct), ch(0), leaf(0)
+    :left(0), right(0), codetable(ct), ch(0), leaf(0)
 {
     if (std::fread(&leaf, sizeof(bool), 1, file) != 1)
         throw std::runtime_error("HuffWT: file read error (Rs).");
@@ -64,33 +276,245 @@ HuffWT::HuffWT(std::FILE *file, TCodeEntry *ct)
 
     if (!leaf)
     {
-        bitrank = new BitRank(file);
+        bitrank.load(file);
         left = new HuffWT(file, ct);
         right = new HuffWT(file, ct);
     }
 }
 
-void HuffWT::save(std::FILE *file)
+/**
+ * Map the node and its subtrees from the node array,
+ * hints is an array of select hint records or 0.
+ */
+HuffWT::HuffWT(MemoryMap const &mm, NodeRecord const *nodes, SelectHints::Record const *hints, ulong nnodes, ulong i, 
+               TCodeEntry *ct, bool copy)
+    :left(0), right(0), codetable(ct), ch(nodes[i].ch), leaf(nodes[i].leaf)
 {
-    if (std::fwrite(&leaf, sizeof(bool), 1, file) != 1)
-        throw std::runtime_error("HuffWT: file write error (Rs).");
-    if (std::fwrite(&ch, sizeof(uchar), 1, file) != 1)
-        throw std::runtime_error("HuffWT: file write error (Rs).");
+    if (!leaf)
+    {
+        if (nodes[i].left <= i || nodes[i].left >= nnodes || nodes[i].right <= i || nodes[i].right >= nnodes)
+            throw std::runtime_error("HuffWT: invalid node record.");
+        bitrank.load(mm, nodes[i].bits, nodes[i].encoding, nodes[i].inverted, copy, hints ? hints + i : 0);
+        left = new HuffWT(mm, nodes, hints, nnodes, nodes[i].left, ct, copy);
+        right = new HuffWT(mm, nodes, hints, nnodes, nodes[i].right, ct, copy);
+    }
+}
 
+/**
+ * Writes the bit-arrays of the subtree and appends its node
+ * and select hint records (in pre-order) to the given vectors.
+ */
+void HuffWT::save(std::FILE *file, std::vector<NodeRecord> &nodes, std::vector<SelectHints::Record> &hints)
+{
+    ulong i = nodes.size();
+    nodes.push_back(NodeRecord());
+    hints.push_back(SelectHints::Record());
+    NodeRecord r;
+    std::memset(&r, 0, sizeof(NodeRecord));
+    SelectHints::Record h;
+    std::memset(&h, 0, sizeof(SelectHints::Record));
+    r.leaf = leaf;
+    r.ch = ch;
     if (!leaf)
     {
-        bitrank->save(file);
-        left->save(file);
-        right->save(file);
+        bitrank.save(file, r.bits, h, r.encoding, r.inverted);
+        r.left = nodes.size();
+        left->save(file, nodes, hints);
+        r.right = nodes.size();
+        right->save(file, nodes, hints);
     }
+    nodes[i] = r;
+    hints[i] = h;
 }
 
+namespace
+{
+    const uchar BASES[] = {'A', 'C', 'G', 'T'};
+}
+
+/**
+ * rank(c, i) for c = A, C, G and T into out[0..3]. The tree is
+ * traversed once: nodes shared by the symbols are ranked only once.
+ */
+void HuffWT::rankAll(ulong i, ulong *out) const
+{
+    if (plan.empty())
+    {
+        for (unsigned k = 0; k < 4; ++k)
+            out[k] = rank(BASES[k], i);
+        return;
+    }
+    ulong pos[MAX_PLAN], rk[MAX_PLAN];
+    out[0] = out[1] = out[2] = out[3] = 0;
+    for (unsigned s = 0; s < plan.size(); ++s)
+    {
+        RankAllStep const &step = plan[s];
+        ulong x = i;
+        if (s)
+            x = step.right ? rk[step.parent] - 1 : pos[step.parent] - rk[step.parent];
+        if (step.bitrank)
+        {
+            pos[s] = x;
+            rk[s] = step.bitrank->rank(x);
+        }
+        else
+            out[step.symbol] = x + 1;
+    }
+}
+
+void HuffWT::rankBatch(uchar const *c, ulong const *i, ulong *out, unsigned k) const
+{
+    for (; k > MAX_BATCH; k -= MAX_BATCH, c += MAX_BATCH, i += MAX_BATCH, out += MAX_BATCH)
+        rankBatch(c, i, out, MAX_BATCH);
+
+    if (k == 1)
+    {
+        out[0] = rank(c[0], i[0]); // Nothing to interleave
+        return;
+    }
+    // out[j] is the position of query j at node[j], 0 when finished
+    HuffWT const *node[MAX_BATCH];
+    unsigned active = 0;
+    for (unsigned j = 0; j < k; ++j)
+    {
+        node[j] = 0;
+        out[j] = i[j];
+        if (codetable[c[j]].count == 0)
+            out[j] = ~0lu; // rank 0
+        else if (!leaf)
+        {
+            node[j] = this;
+            bitrank.prefetch(i[j]);
+            ++active;
+        }
+    }
+    for (unsigned level = 0; active; ++level)
+        for (unsigned j = 0; j < k; ++j)
+        {
+            HuffWT const *temp = node[j];
+            if (!temp)
+                continue;
+            ulong r = temp->bitrank.rank(out[j]);
+            if ((codetable[c[j]].code & (1u<<level)) == 0)
+            {
+                out[j] = out[j] - r;
+                temp = temp->left;
+            }
+            else
+            {
+                out[j] = r - 1;
+                temp = temp->right;
+            }
+            if (temp->leaf)
+            {
+                temp = 0;
+                --active;
+            }
+            else
+                temp->bitrank.prefetch(out[j]);
+            node[j] = temp;
+        }
+    for (unsigned j = 0; j < k; ++j)
+        ++out[j];
+}
+
+void HuffWT::rankAllBatch(ulong const *i, ulong *out, unsigned k) const
+{
+    if (plan.empty() || k == 1)
+    {
+        for (unsigned j = 0; j < k; ++j)
+            rankAll(i[j], out + 4*j);
+        return;
+    }
+    // pos and rk of step s and query j at s*b + j
+    unsigned b = MAX_BATCH * 8 / plan.size();
+    if (b > MAX_BATCH)
+        b = MAX_BATCH;
+    for (; k > b; k -= b, i += b, out += 4*b)
+        rankAllBatch(i, out, b);
+
+    ulong pos[MAX_BATCH * 8], rk[MAX_BATCH * 8];
+    for (unsigned j = 0; j < 4*k; ++j)
+        out[j] = 0;
+    for (unsigned s = 0; s < plan.size(); ++s)
+    {
+        RankAllStep const &step = plan[s];
+        ulong *x = pos + s*b;
+        for (unsigned j = 0; j < k; ++j)
+        {
+            x[j] = i[j];
+            if (s)
+                x[j] = step.right ? rk[step.parent*b + j] - 1 : pos[step.parent*b + j] - rk[step.parent*b + j];
+            if (step.bitrank)
+                step.bitrank->prefetch(x[j]);
+            else
+                out[4*j + step.symbol] = x[j] + 1;
+        }
+        if (step.bitrank)
+            for (unsigned j = 0; j < k; ++j)
+                rk[s*b + j] = step.bitrank->rank(x[j]);
+    }
+}
+
+/**
+ * Builds the traversal plan of rankAll() for the root
+ */
+void HuffWT::makePlan()
+{
+    struct Item
+    {
+        HuffWT const *node;
+        unsigned parent;
+        unsigned right;
+        unsigned mask; // bit k for the k:th symbol of ACGT
+    };
+    plan.clear();
+    Item root = {this, 0, 0, 0};
+    for (unsigned k = 0; k < 4; ++k)
+        if (codetable[BASES[k]].count)
+            root.mask |= 1u << k;
+    if (!root.mask)
+        return;
+    std::vector<Item> queue(1, root);
+    std::vector<unsigned> level(1, 0);
+    for (unsigned q = 0; q < queue.size(); ++q)
+    {
+        Item it = queue[q];
+        RankAllStep step = {0, it.parent, it.right, 0};
+        if (it.node->leaf)
+        {
+            for (unsigned k = 0; k < 4; ++k)
+                if (it.mask & (1u << k))
+                    step.symbol = k;
+            plan.push_back(step);
+            continue;
+        }
+        step.bitrank = &it.node->bitrank;
+        plan.push_back(step);
+        unsigned left = 0;
+        for (unsigned k = 0; k < 4; ++k)
+            if ((it.mask & (1u << k)) && (codetable[BASES[k]].code & (1u << level[q])) == 0)
+                left |= 1u << k;
+        if (left)
+        {
+            Item child = {it.node->left, q, 0, left};
+            queue.push_back(child);
+            level.push_back(level[q] + 1);
+        }
+        if (left != it.mask)
+        {
+            Item child = {it.node->right, q, 1, it.mask & ~left};
+            queue.push_back(child);
+            level.push_back(level[q] + 1);
+        }
+    }
+    if (plan.size() > MAX_PLAN)
+        plan.clear(); // rankAll() falls back to rank()
+}
 
 HuffWT::~HuffWT() {
     if (left) delete left;
     if (right) delete right;
-    if (bitrank)   
-        delete bitrank;
 }
 
 class node 
@@ -125,6 +549,7 @@ public:
     }
 
     static HuffWT::TCodeEntry *makecodetable(uchar *, ulong);
+    static HuffWT::TCodeEntry *makecodetable(HuffWT::TCodeEntry *);
 };
 
 
@@ -135,6 +560,12 @@ HuffWT::TCodeEntry * node::makecodetable(uchar *text, ulong n)
     HuffWT::TCodeEntry *result = new HuffWT::TCodeEntry[ 256 ];
     
     count_chars( text, n, result );
+    return makecodetable(result);
+}
+
+// Codes for the symbol counts of the given table
+HuffWT::TCodeEntry * node::makecodetable(HuffWT::TCodeEntry *result)
+{
     std::priority_queue< node, std::vector< node >, std::greater<node> > q;
     for ( unsigned i = 0 ; i < 256 ; i++ )
         if ( result[ i ].count )
@@ -188,14 +619,102 @@ HuffWT * HuffWT::makeHuffWT(uchar *bwt, ulong n)
     std::cerr << "Constructing hufftable... " <<  std::endl;
     HuffWT::TCodeEntry * codetable = node::makecodetable(bwt,n);
     std::cerr << "hufftable done... creating tree... " <<  std::endl;
-    return new HuffWT(bwt, n, codetable, 0);
+    HuffWT *wt = 0;
+    std::string error;
+    // Subtrees are built as OpenMP tasks by the threads of this team
+#ifdef PARALLEL_SUPPORT
+    #pragma omp parallel shared(error)
+    #pragma omp single
+#endif
+    try
+    {
+        wt = new HuffWT(bwt, n, codetable, 0);
+    }
+    catch (std::exception const &e)
+    {
+        recordError(error, e);
+    }
+    delete [] bwt;
+    if (!error.empty())
+    {
+        delete [] codetable;
+        throw std::runtime_error(error);
+    }
+    wt->makePlan();
+    return wt;
 }
 
-void HuffWT::save(HuffWT *wt,std::FILE *file)
+/**
+ * Builds the tree from the disk-resident BWT (see ExternalSequence).
+ */
+HuffWT * HuffWT::makeHuffWT(ExternalSequence const &bwt)
 {
-    for (unsigned i = 0; i < 256; ++i)
-        wt->codetable[i].save(file);
-    wt->save(file);
+    std::cerr << "Constructing hufftable... " <<  std::endl;
+    HuffWT::TCodeEntry * codetable = new HuffWT::TCodeEntry[256];
+    for (unsigned c = 0; c < 256; ++c)
+        codetable[c].count = bwt.count(c);
+    node::makecodetable(codetable);
+    std::cerr << "hufftable done... creating tree from disk... " <<  std::endl;
+    HuffWT *wt = 0;
+    std::string error;
+#ifdef PARALLEL_SUPPORT
+    #pragma omp parallel shared(error)
+    #pragma omp single
+#endif
+    try
+    {
+        wt = makeNode(bwt, 0, bwt.length(), codetable, 0);
+    }
+    catch (std::exception const &e)
+    {
+        recordError(error, e);
+    }
+    if (!error.empty())
+    {
+        delete [] codetable;
+        throw std::runtime_error(error);
+    }
+    wt->makePlan();
+    return wt;
+}
+
+/**
+ * Node of the symbols s[from..from+n-1] of the file of the level
+ * (level % 2), built in memory if they fit the RAM budget.
+ */
+HuffWT * HuffWT::makeNode(ExternalSequence const &s, ulong from, ulong n, TCodeEntry *codetable, unsigned level)
+{
+    if (n > s.memoryLength())
+        return new HuffWT(s, from, n, codetable, level);
+    uchar *t = new uchar[n];
+    s.read(level % 2, from, t, n);
+    HuffWT *wt = new HuffWT(t, n, codetable, level);
+    delete [] t;
+    return wt;
+}
+
+/**
+ * Save in the page-aligned layout: the bit-arrays of all nodes
+ * are written first, followed by a directory containing the number 
+ * of nodes, the code table, the node records and the select
+ * hint records (FMIndex v20).
+ *
+ * Returns the file offset of the directory.
+ */
+ulong HuffWT::save(HuffWT *wt,std::FILE *file)
+{
+    std::vector<NodeRecord> nodes;
+    std::vector<SelectHints::Record> hints;
+    wt->save(file, nodes, hints);
+
+    ulong nnodes = nodes.size();
+    ulong offset = MemoryMap::write(file, &nnodes, sizeof(ulong), sizeof(ulong));
+    // The code table as one section, laid out as by TCodeEntry::save()
+    static_assert(sizeof(TCodeEntry) == sizeof(ulong) + 2*sizeof(unsigned), "TCodeEntry is not packed");
+    MemoryMap::write(file, wt->codetable, 256 * sizeof(TCodeEntry), sizeof(ulong));
+    MemoryMap::write(file, &nodes[0], nnodes * sizeof(NodeRecord), sizeof(ulong));
+    MemoryMap::write(file, &hints[0], nnodes * sizeof(SelectHints::Record), sizeof(ulong));
+    return offset;
 }
 
 HuffWT * HuffWT::load(std::FILE *file, uchar verFlag)
@@ -203,7 +722,48 @@ HuffWT * HuffWT::load(std::FILE *file, uchar verFlag)
     TCodeEntry *ct = new HuffWT::TCodeEntry[ 256 ];
     for (unsigned i = 0; i < 256; ++i)
         ct[i].load(file, verFlag);
-    return new HuffWT(file, ct);
+    HuffWT *wt = new HuffWT(file, ct);
+    wt->makePlan();
+    return wt;
+}
+
+/**
+ * Load the page-aligned layout from the given directory offset.
+ * Only the node shells and the code table are allocated, the
+ * bit-arrays are used in place from the mapping unless a
+ * private copy is requested. The select hint records follow
+ * the node records if hasHints is true.
+ */
+HuffWT * HuffWT::load(MemoryMap const &mm, ulong offset, bool hasHints, bool copy)
+{
+    ulong nnodes = *mm.at<ulong>(offset, 1);
+    offset += sizeof(ulong);
+    TCodeEntry *ct = new HuffWT::TCodeEntry[ 256 ];
+    for (unsigned i = 0; i < 256; ++i)
+    {
+        ct[i].count = *mm.at<ulong>(offset, 1);
+        ct[i].bits = *mm.at<unsigned>(offset + sizeof(ulong), 1);
+        ct[i].code = *mm.at<unsigned>(offset + sizeof(ulong) + sizeof(unsigned), 1);
+        offset += sizeof(ulong) + 2*sizeof(unsigned);
+    }
+    if (nnodes == 0)
+        throw std::runtime_error("HuffWT: empty node directory.");
+    NodeRecord const *nodes = mm.at<NodeRecord>(offset, nnodes);
+    SelectHints::Record const *hints = 0;
+    if (hasHints)
+        hints = mm.at<SelectHints::Record>(offset + nnodes * sizeof(NodeRecord), nnodes);
+    HuffWT *wt = new HuffWT(mm, nodes, hints, nnodes, 0, ct, copy);
+    wt->makePlan();
+    return wt;
+}
+
+void HuffWT::getRegions(std::vector<std::pair<void const *, ulong> > &regions) const
+{
+    if (leaf)
+        return;
+    bitrank.getRegions(regions);
+    left->getRegions(regions);
+    right->getRegions(regions);
 }
 
 void HuffWT::deleteHuffWT(HuffWT *wt)
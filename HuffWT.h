@@ -2,14 +2,19 @@
 #define _HUFFWT_H_
 
 
-#include "BitRank.h"
+#include "NodeBitVector.h"
+#include "ExternalSequence.h"
 
 #include <cstdio>
 #include <stdexcept>
+#include <vector>
 
 class HuffWT 
 {
 public:
+    // Plain bit-vector of the tree nodes, selected at build time
+    typedef NodeBitVector::Plain BitVector;
+
     class TCodeEntry 
     {
     public:
@@ -45,8 +50,27 @@ public:
         }
     };
 
+    /**
+     * Tree node in the page-aligned index layout (FMIndex v18).
+     * Nodes are stored in pre-order; children are referred to
+     * by their index in the node array instead of a pointer.
+     * The encoding of the bit-vector (see NodeBitVector) is 0 (plain)
+     * in indexes built before the compressed encodings.
+     */
+    struct NodeRecord
+    {
+        BitRank::Record bits;
+        ulong left;
+        ulong right;
+        uchar leaf;
+        uchar ch;
+        uchar encoding;
+        uchar inverted;
+        uchar padding[4];
+    };
+
 private:
-    BitRank *bitrank;
+    NodeBitVector bitrank; // Not used in a leaf
     HuffWT *left;
     HuffWT *right;
     TCodeEntry *codetable;
@@ -54,13 +78,41 @@ private:
     bool leaf;
 
     HuffWT(uchar *, ulong, TCodeEntry *, unsigned);
-    void save(std::FILE *);
+    HuffWT(ExternalSequence const &, ulong, ulong, TCodeEntry *, unsigned);
+    static HuffWT * makeNode(ExternalSequence const &, ulong, ulong, TCodeEntry *, unsigned);
     HuffWT(std::FILE *, TCodeEntry *);
+    HuffWT(MemoryMap const &, NodeRecord const *, SelectHints::Record const *, ulong, ulong, TCodeEntry *, bool);
+    void save(std::FILE *, std::vector<NodeRecord> &, std::vector<SelectHints::Record> &);
+
+    /**
+     * Traversal plan of rankAll(), built for the root: the nodes on the
+     * paths to the leaves of A, C, G and T in level order. Each step refers
+     * to the step of its parent, so the rank queries on the same level are
+     * independent and their cache misses can overlap.
+     */
+    struct RankAllStep
+    {
+        NodeBitVector const *bitrank; // 0 for a leaf
+        unsigned parent;
+        unsigned right;
+        unsigned symbol; // leaf: index of the symbol in ACGT
+    };
+    static const unsigned MAX_PLAN = 256;
+    std::vector<RankAllStep> plan;
+    void makePlan();
 public:
+    // Queries evaluated in lockstep by rankBatch() and rankAllBatch()
+    static const unsigned MAX_BATCH = 32;
+    // Shorter subtrees are not built by a separate thread
+    static const ulong PARALLEL_MIN_LENGTH = 1024*1024;
+
     static HuffWT * makeHuffWT(uchar *bwt, ulong n);
+    static HuffWT * makeHuffWT(ExternalSequence const &);
     static HuffWT * load(std::FILE *, uchar verFlag);
-    static void save(HuffWT *, std::FILE *);
+    static HuffWT * load(MemoryMap const &, ulong, bool, bool = false);
+    static ulong save(HuffWT *, std::FILE *);
     static void deleteHuffWT(HuffWT *);
+    void getRegions(std::vector<std::pair<void const *, ulong> > &) const;
     ~HuffWT(); const
         
     inline ulong rank(uchar c, ulong i) const { // returns the number of characters c before and including position i
@@ -70,11 +122,11 @@ public:
         unsigned code = codetable[c].code;
         while (!temp->leaf) {
             if ((code & (1u<<level)) == 0) {
-                i = i-temp->bitrank->rank(i); 
+                i = i-temp->bitrank.rank(i); 
                 temp = temp->left; 
             }
             else { 
-                i = temp->bitrank->rank(i)-1; 
+                i = temp->bitrank.rank(i)-1; 
                 temp = temp->right;
             }
             ++level;
@@ -82,6 +134,23 @@ public:
         return i+1;
     };   
 
+    /**
+     * rank(c, i) for c = A, C, G and T into out[0..3]. The tree is
+     * traversed once: nodes shared by the symbols are ranked only once.
+     */
+    void rankAll(ulong, ulong *) const;
+
+    /**
+     * rank(c[j], i[j]) into out[j] for j < k. The independent queries
+     * advance one level at a time in lockstep: the lines of the next
+     * node are prefetched for every query before any of them is ranked,
+     * so that their cache misses overlap instead of forming one chain.
+     */
+    void rankBatch(uchar const *, ulong const *, ulong *, unsigned) const;
+
+    // rankAll(i[j], out + 4*j) for j < k, in lockstep as above
+    void rankAllBatch(ulong const *, ulong *, unsigned) const;
+
     inline ulong select(uchar c, ulong i, unsigned level = 0) const 
     {
         if (leaf)
@@ -92,12 +161,12 @@ public:
         unsigned code = codetable[c].code;
             if ((code & (1u<<level)) == 0) {
                 i = left->select(c, i, level+1);
-                i = bitrank->select0(i+1); 
+                i = bitrank.select0(i+1); 
             }
             else 
             {
                 i = right->select(c, i, level+1);
-                i = bitrank->select(i+1); 
+                i = bitrank.select(i+1); 
             }
         return i;
     };   
@@ -110,13 +179,13 @@ public:
         unsigned code = codetable[c].code;      
         while (!temp->leaf) {
             if ((code & (1u<<level))==0) {
-                if (temp->bitrank->IsBitSet(i)) return false;
-                i = i-temp->bitrank->rank(i); 
+                if (temp->bitrank.IsBitSet(i)) return false;
+                i = i-temp->bitrank.rank(i); 
                     temp = temp->left; 
             }
             else { 
-                if (!temp->bitrank->IsBitSet(i)) return false;         
-                i = temp->bitrank->rank(i)-1; 
+                if (!temp->bitrank.IsBitSet(i)) return false;         
+                i = temp->bitrank.rank(i)-1; 
                 temp = temp->right;
             }
             ++level;
@@ -127,12 +196,12 @@ public:
     {
         HuffWT const *temp=this;
         while (!temp->leaf) {
-            if (temp->bitrank->IsBitSet(i)) {
-                i = temp->bitrank->rank(i)-1;
+            if (temp->bitrank.IsBitSet(i)) {
+                i = temp->bitrank.rank(i)-1;
                 temp = temp->right;
             }
             else {
-                i = i-temp->bitrank->rank(i); 
+                i = i-temp->bitrank.rank(i); 
                 temp = temp->left;      
             }         
         }
@@ -143,12 +212,12 @@ public:
     {
         HuffWT const *temp=this;
         while (!temp->leaf) {
-            if (temp->bitrank->IsBitSet(i)) {
-                i = temp->bitrank->rank(i)-1;
+            if (temp->bitrank.IsBitSet(i)) {
+                i = temp->bitrank.rank(i)-1;
                 temp = temp->right;
             }
             else {
-                i = i-temp->bitrank->rank(i); 
+                i = i-temp->bitrank.rank(i); 
                 temp = temp->left;      
             }         
         }
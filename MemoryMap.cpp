@@ -0,0 +1,262 @@
+#include "MemoryMap.h"
+#include "Numa.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <cerrno>
+#include <algorithm>
+#include <sstream>
+#include <utility>
+#ifdef PARALLEL_SUPPORT
+#include <omp.h>
+#endif
+
+namespace
+{
+    // Table of the sections written by MemoryMap::write(), if recording
+    std::vector<MemoryMap::Section> *recorded = 0;
+}
+
+MemoryMap::MemoryMap(std::string const &filename, bool hugepages)
+    : base(0), length(0), allocated(0), type(BACKING_FILE)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("MemoryMap::MemoryMap(): file not found.");
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("MemoryMap::MemoryMap(): unable to stat the file.");
+    }
+    length = st.st_size;
+
+    if (hugepages)
+    {
+        bool ok = readFile(fd);
+        close(fd);
+        if (!ok)
+            throw std::runtime_error("MemoryMap::MemoryMap(): unable to read the file into huge pages.");
+        return;
+    }
+
+    // Shared read-only mapping: pages come from the OS page cache
+    void *p = mmap(0, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps its own reference
+    if (p == MAP_FAILED)
+        throw std::runtime_error("MemoryMap::MemoryMap(): mmap failed.");
+    base = (uchar *)p;
+
+    // Rank queries access the bit arrays randomly; readahead does not help
+    madvise(base, length, MADV_RANDOM);
+}
+
+MemoryMap::~MemoryMap()
+{
+    if (base)
+        munmap(base, allocated ? allocated : length);
+}
+
+/**
+ * Read the whole file into anonymous memory backed by huge pages
+ */
+bool MemoryMap::readFile(int fd)
+{
+    allocated = (length / HUGE_PAGE_SIZE + 1) * HUGE_PAGE_SIZE;
+    void *p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    // Explicit huge pages must be reserved by the administrator (vm.nr_hugepages)
+    p = mmap(0, allocated, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    type = BACKING_HUGETLB;
+#endif
+    if (p == MAP_FAILED)
+    {
+        // Transparent huge pages need a 2 MB aligned range: over-allocate and trim
+        uchar *q = (uchar *)mmap(0, allocated + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, 
+                                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (q == MAP_FAILED)
+            return false;
+        ulong head = (HUGE_PAGE_SIZE - (ulong)q % HUGE_PAGE_SIZE) % HUGE_PAGE_SIZE;
+        if (head)
+            munmap(q, head);
+        munmap(q + head + allocated, HUGE_PAGE_SIZE - head);
+        p = q + head;
+#ifdef MADV_HUGEPAGE
+        madvise(p, allocated, MADV_HUGEPAGE);
+#endif
+        type = BACKING_THP;
+    }
+    base = (uchar *)p;
+    // The pages are touched first by the reading threads below, which
+    // do not share the NUMA policy of this thread (see metaenumerate --numa)
+    Numa::bindRange(base, allocated);
+
+    // Pieces are read by all threads: parallel requests keep
+    // a network file system busy, one sequential read does not
+    long pieces = (length + PIECE_SIZE - 1) / PIECE_SIZE;
+    bool failed = false;
+#ifdef PARALLEL_SUPPORT
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (long i = 0; i < pieces; ++i)
+    {
+        ulong done = i * PIECE_SIZE;
+        ulong end = std::min(length, done + PIECE_SIZE);
+        while (done < end)
+        {
+            ssize_t r = pread(fd, base + done, end - done, done);
+            if (r < 0 && errno == EINTR)
+                continue;
+            if (r <= 0)
+            {
+#ifdef PARALLEL_SUPPORT
+                #pragma omp atomic write
+#endif
+                failed = true;
+                break;
+            }
+            done += r;
+        }
+    }
+    if (failed)
+    {
+        munmap(base, allocated);
+        base = 0;
+        return false;
+    }
+    mprotect(base, allocated, PROT_READ);
+    return true;
+}
+
+char const * MemoryMap::backingName(Backing b)
+{
+    switch (b)
+    {
+    case BACKING_FILE:    return "file mapping";
+    case BACKING_HUGETLB: return "explicit huge pages";
+    case BACKING_THP:     return "transparent huge pages";
+    }
+    return "unknown";
+}
+
+ulong MemoryMap::write(std::FILE *file, void const *data, ulong bytes, ulong alignment)
+{
+    long pos = std::ftell(file);
+    if (pos < 0)
+        throw std::runtime_error("MemoryMap::write(): file position error.");
+
+    ulong offset = pos;
+    if (offset % alignment)
+    {
+        ulong pad = alignment - offset % alignment;
+        static const char zeros[PAGE_SIZE] = {0};
+        while (pad)
+        {
+            ulong len = pad < PAGE_SIZE ? pad : PAGE_SIZE;
+            if (std::fwrite(zeros, 1, len, file) != len)
+                throw std::runtime_error("MemoryMap::write(): file write error (padding).");
+            pad -= len;
+            offset += len;
+        }
+    }
+    if (bytes && std::fwrite(data, 1, bytes, file) != bytes)
+        throw std::runtime_error("MemoryMap::write(): file write error (section).");
+    if (recorded && bytes)
+    {
+        Section s = {offset, bytes, crc(data, bytes)};
+        recorded->push_back(s);
+    }
+    return offset;
+}
+
+void MemoryMap::recordSections(std::vector<Section> *table)
+{
+    recorded = table;
+}
+
+ulong MemoryMap::writeSections(std::FILE *file, std::vector<Section> const &table)
+{
+    ulong count = table.size();
+    ulong offset = write(file, &count, sizeof(ulong), sizeof(ulong));
+    ulong tableCrc = crc32(0, count ? (Bytef const *)&table[0] : Z_NULL, count * sizeof(Section));
+    if (count && std::fwrite(&table[0], sizeof(Section), count, file) != count)
+        throw std::runtime_error("MemoryMap::writeSections(): file write error (section table).");
+    if (std::fwrite(&tableCrc, sizeof(ulong), 1, file) != 1)
+        throw std::runtime_error("MemoryMap::writeSections(): file write error (section table).");
+    return offset;
+}
+
+/**
+ * CRC-32 of the pieces, combined in order
+ */
+ulong MemoryMap::crc(void const *data, ulong bytes)
+{
+    uchar const *p = (uchar const *)data;
+    long pieces = (bytes + PIECE_SIZE - 1) / PIECE_SIZE;
+    if (pieces <= 1)
+        return crc32(0, bytes ? p : Z_NULL, bytes);
+    std::vector<ulong> crcs(pieces);
+#ifdef PARALLEL_SUPPORT
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (long i = 0; i < pieces; ++i)
+        crcs[i] = crc32(0, p + i * PIECE_SIZE, std::min(PIECE_SIZE, bytes - i * PIECE_SIZE));
+    ulong c = 0;
+    for (long i = 0; i < pieces; ++i)
+        c = crc32_combine(c, crcs[i], std::min(PIECE_SIZE, bytes - i * PIECE_SIZE));
+    return c;
+}
+
+void MemoryMap::verifySections(ulong offset) const
+{
+    ulong count = *at<ulong>(offset, 1);
+    Section const *table = at<Section>(offset + sizeof(ulong), count);
+    ulong tableCrc = *at<ulong>(offset + sizeof(ulong) + count * sizeof(Section), 1);
+    if (crc32(0, count ? (Bytef const *)table : Z_NULL, count * sizeof(Section)) != tableCrc)
+        throw std::runtime_error("MemoryMap::verifySections(): CRC mismatch in the section table, index file is corrupted.");
+
+    // Pieces (section, offset inside the section) of all sections, so
+    // that the threads share the large sections too
+    std::vector<std::pair<ulong, ulong> > pieces;
+    for (ulong s = 0; s < count; ++s)
+    {
+        at<uchar>(table[s].offset, table[s].length);
+        for (ulong p = 0; p < table[s].length; p += PIECE_SIZE)
+            pieces.push_back(std::make_pair(s, p));
+    }
+    if (type == BACKING_FILE)
+        madvise(base, length, MADV_SEQUENTIAL);
+    std::vector<ulong> crcs(pieces.size());
+#ifdef PARALLEL_SUPPORT
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for (long i = 0; i < (long)pieces.size(); ++i)
+    {
+        Section const &s = table[pieces[i].first];
+        ulong p = pieces[i].second;
+        crcs[i] = crc32(0, base + s.offset + p, std::min(PIECE_SIZE, s.length - p));
+    }
+    if (type == BACKING_FILE)
+        madvise(base, length, MADV_RANDOM);
+
+    std::vector<ulong> sectionCrc(count, 0);
+    for (ulong i = 0; i < pieces.size(); ++i)
+    {
+        Section const &s = table[pieces[i].first];
+        ulong p = pieces[i].second;
+        sectionCrc[pieces[i].first] = crc32_combine(sectionCrc[pieces[i].first], crcs[i], std::min(PIECE_SIZE, s.length - p));
+    }
+    for (ulong s = 0; s < count; ++s)
+        if (sectionCrc[s] != table[s].crc)
+        {
+            std::ostringstream oss;
+            oss << "MemoryMap::verifySections(): CRC mismatch in section " << s << " (offset " << table[s].offset
+                << "), index file is corrupted.";
+            throw std::runtime_error(oss.str());
+        }
+}
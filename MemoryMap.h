@@ -0,0 +1,121 @@
+/**
+ * Read-only memory mapping of an index file.
+ *
+ * Used by the page-aligned index layout (FMIndex v18): the large
+ * bit arrays are used in place from the mapping, so that loading
+ * does not copy them and the OS page cache is shared by all processes
+ * that map the same file.
+ *
+ * Alternatively the file can be read into private memory backed by
+ * 2 MB huge pages, which reduces the TLB misses of random rank queries.
+ *
+ * Since FMIndex v24 the file ends with a table of its sections and
+ * their CRC-32, which are checked in parallel on request (verifySections).
+ */
+
+#ifndef _MEMORYMAP_H_
+#define _MEMORYMAP_H_
+
+#include "Tools.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+class MemoryMap
+{
+public:
+    // Alignment of the sections inside the file
+    static const ulong PAGE_SIZE = 4096;
+    static const ulong HUGE_PAGE_SIZE = 2048*1024;
+    // Unit of the parallel reads and CRC computations
+    static const ulong PIECE_SIZE = 8*1024*1024;
+
+    // Section of the file and the CRC-32 of its contents (FMIndex v24)
+    struct Section
+    {
+        ulong offset;
+        ulong length;
+        ulong crc;
+    };
+
+    // Memory that backs the mapping
+    enum Backing {BACKING_FILE,     // shared file mapping (page cache)
+                  BACKING_HUGETLB,  // explicit huge pages (MAP_HUGETLB)
+                  BACKING_THP};     // transparent huge pages (MADV_HUGEPAGE)
+
+    /**
+     * Map the given file. If hugepages is true, the file is read into
+     * anonymous memory: explicit huge pages are tried first, then
+     * transparent huge pages.
+     */
+    explicit MemoryMap(std::string const &, bool hugepages = false);
+    ~MemoryMap();
+
+    inline ulong size() const
+    { return length; }
+    inline Backing backing() const
+    { return type; }
+    static char const * backingName(Backing);
+
+    /**
+     * Pointer to count items of type T at given file offset.
+     *
+     * Throws a std::runtime_error exception if the section
+     * does not fit inside the file.
+     */
+    template<typename T>
+    inline T * at(ulong offset, ulong count) const
+    {
+        if (offset > length || count > (length - offset) / sizeof(T) || offset % __alignof__(T) != 0)
+            throw std::runtime_error("MemoryMap::at(): section out of bounds, index file is truncated or corrupted.");
+        return (T *)(base + offset);
+    }
+
+    /**
+     * Write a section to the given file handle, padding the file with
+     * zeros up to the given alignment first.
+     *
+     * Returns the file offset of the section.
+     * Throws a std::runtime_error exception on i/o error.
+     */
+    static ulong write(std::FILE *, void const *, ulong, ulong = PAGE_SIZE);
+
+    /**
+     * The sections written by write() are appended to the given
+     * table until recording is stopped with 0. One file can be
+     * recorded at a time.
+     */
+    static void recordSections(std::vector<Section> *);
+    /**
+     * Write the section table, followed by its own CRC-32.
+     * Returns the file offset of the table.
+     */
+    static ulong writeSections(std::FILE *, std::vector<Section> const &);
+    /**
+     * Check the CRC-32 of each section in the table at the given
+     * offset. The sections are read in pieces by all OpenMP threads,
+     * so that a file mapping is loaded in parallel with readahead.
+     *
+     * Throws a std::runtime_error exception if a CRC does not match.
+     */
+    void verifySections(ulong) const;
+
+    // CRC-32 of the given bytes, pieces in parallel
+    static ulong crc(void const *, ulong);
+
+private:
+    uchar *base;
+    ulong length;
+    ulong allocated; // size of the anonymous mapping
+    Backing type;
+
+    bool readFile(int);
+
+    // No copy constructor or assignment
+    MemoryMap(MemoryMap const&);
+    MemoryMap& operator = (MemoryMap const&);
+};
+
+#endif
@@ -0,0 +1,222 @@
+#include "NodeBitVector.h"
+
+// Include from libcds
+#include <static_bitsequence.h>
+
+#include <cstdlib>
+#include <stdexcept>
+
+NodeBitVector::Policy NodeBitVector::policy = NodeBitVector::POLICY_PLAIN;
+
+namespace
+{
+    // libcds positions are 32 bit, sdarray uses signed ints
+    const ulong MAX_COMPRESSED_BITS = 1lu << 31;
+    // Shorter nodes stay plain: the fixed size of the libcds structures dominates
+    const ulong MIN_COMPRESSED_BITS = 1lu << 14;
+    // Bits per word of the bit-arrays (libcds redefines W as 32)
+    const ulong WORD_BITS = 8 * sizeof(ulong);
+}
+
+bool NodeBitVector::usePolicy(std::string const &name)
+{
+    if (name == "plain")
+        policy = POLICY_PLAIN;
+    else if (name == "auto")
+        policy = POLICY_AUTO;
+    else
+        return false;
+    return true;
+}
+
+char const * NodeBitVector::encodingName(Encoding e)
+{
+    switch (e)
+    {
+    case ENCODING_RRR: return "RRR";
+    case ENCODING_SPARSE: return "sparse";
+    default: return "plain";
+    }
+}
+
+NodeBitVector::NodeBitVector()
+    : plain(0), seq(0), n(0), enc(ENCODING_PLAIN), inverted(false)
+{ }
+
+NodeBitVector::~NodeBitVector()
+{
+    delete plain;
+    if (enc == ENCODING_RRR)
+    {
+        // Releases the shared table of libcds (see build())
+#ifdef PARALLEL_SUPPORT
+        #pragma omp critical (NODEBITVECTOR_RRR)
+#endif
+        delete seq;
+    }
+    else
+        delete seq;
+}
+
+/**
+ * Choose the encoding by the density of the minority bit (see the policy)
+ */
+void NodeBitVector::build(ulong *B, ulong n, ulong ones)
+{
+    this->n = n;
+    ulong m = ones < n - ones ? ones : n - ones;
+    if (policy == POLICY_PLAIN || n < MIN_COMPRESSED_BITS || n >= MAX_COMPRESSED_BITS || m * 8 > n)
+    {
+        plain = new Plain(B, n, true);
+        return;
+    }
+
+    // libcds reads the bits as 32 bit words, same order on little endian
+    if (m * 64 <= n)
+    {
+        enc = ENCODING_SPARSE;
+        if (ones > n / 2)
+        {
+            inverted = true;
+            for (ulong i = 0; i < n/WORD_BITS+1; ++i)
+                B[i] = ~B[i];
+            if (n % WORD_BITS)
+                B[n/WORD_BITS] &= (1lu << (n % WORD_BITS)) - 1;
+            else
+                B[n/WORD_BITS] = 0;
+        }
+        seq = new static_bitsequence_sdarray((uint *)B, n);
+    }
+    else
+    {
+        enc = ENCODING_RRR;
+        // The first rrr02 creates the shared table of libcds and each one
+        // counts its users without locking: every rrr02 is created, loaded
+        // and deleted in this critical section, the nodes may be built,
+        // loaded and deleted in parallel
+#ifdef PARALLEL_SUPPORT
+        #pragma omp critical (NODEBITVECTOR_RRR)
+#endif
+        seq = new static_bitsequence_rrr02((uint *)B, n);
+    }
+    delete [] B;
+}
+
+void NodeBitVector::load(std::FILE *file)
+{
+    plain = new Plain(file);
+}
+
+/**
+ * Plain bit-vectors are mapped as before. The record of a compressed
+ * node points to the libcds serialization: data is its offset and
+ * integers its size in bytes.
+ */
+void NodeBitVector::load(MemoryMap const &mm, BitRank::Record const &r, uchar encoding, uchar complement,
+                         bool copy, SelectHints::Record const *h)
+{
+    n = r.n;
+    if (encoding == ENCODING_PLAIN)
+    {
+        plain = new Plain(mm, r, copy, h);
+        return;
+    }
+    if (encoding != ENCODING_RRR && encoding != ENCODING_SPARSE)
+        throw std::runtime_error("NodeBitVector::load(): unknown node encoding (index was built with a newer version?).");
+    if (n >= MAX_COMPRESSED_BITS)
+        throw std::runtime_error("NodeBitVector::load(): invalid node record.");
+    enc = encoding;
+    inverted = complement;
+
+    uchar *bytes = mm.at<uchar>(r.data, r.integers);
+    std::FILE *file = fmemopen(bytes, r.integers, "rb");
+    if (!file)
+        throw std::runtime_error("NodeBitVector::load(): unable to read the compressed bit-vector.");
+    if (encoding == ENCODING_RRR)
+    {
+        // Uses the shared table of libcds (see build())
+#ifdef PARALLEL_SUPPORT
+        #pragma omp critical (NODEBITVECTOR_RRR)
+#endif
+        seq = static_bitsequence::load(file);
+    }
+    else
+        seq = static_bitsequence::load(file);
+    std::fclose(file);
+    if (!seq || seq->length() != n)
+        throw std::runtime_error("NodeBitVector::load(): invalid compressed bit-vector.");
+}
+
+void NodeBitVector::save(std::FILE *file, BitRank::Record &r, SelectHints::Record &h, uchar &encoding, uchar &complement)
+{
+    encoding = enc;
+    complement = inverted;
+    if (plain)
+    {
+        plain->save(file, r, h);
+        return;
+    }
+
+    char *buf = 0;
+    size_t size = 0;
+    std::FILE *mem = open_memstream(&buf, &size);
+    if (!mem)
+        throw std::runtime_error("NodeBitVector::save(): unable to serialize the compressed bit-vector.");
+    int err = seq->save(mem);
+    std::fclose(mem);
+    if (err)
+    {
+        std::free(buf);
+        throw std::runtime_error("NodeBitVector::save(): unable to serialize the compressed bit-vector.");
+    }
+    r.n = n;
+    r.integers = size;
+    r.b = r.s = 0; // Rejected as a plain bit-vector by older versions
+    try
+    {
+        r.data = MemoryMap::write(file, buf, size, sizeof(ulong));
+    }
+    catch (...)
+    {
+        std::free(buf);
+        throw;
+    }
+    std::free(buf);
+}
+
+ulong NodeBitVector::compressedSize() const
+{
+    return seq ? seq->size() : 0;
+}
+
+void NodeBitVector::getRegions(std::vector<std::pair<void const *, ulong> > &regions) const
+{
+    if (plain)
+        plain->getRegions(regions);
+}
+
+ulong NodeBitVector::compressedRank(ulong i) const
+{
+    if (i == ~0lu)
+        return 0;
+    ulong r = seq->rank1(i);
+    return inverted ? i + 1 - r : r;
+}
+
+/**
+ * As in the plain bit-vector: 0 for x = 0, n if the bit does not exist
+ */
+ulong NodeBitVector::compressedSelect(ulong x, bool one) const
+{
+    if (x == 0)
+        return 0;
+    if (x > n)
+        return n;
+    uint p = one != inverted ? seq->select1(x) : seq->select0(x);
+    return p == (uint)-1 ? n : p;
+}
+
+bool NodeBitVector::compressedAccess(ulong i) const
+{
+    return seq->access(i) != inverted;
+}
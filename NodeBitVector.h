@@ -0,0 +1,122 @@
+/**
+ * Bit-vector of a HuffWT node: plain or compressed with libcds.
+ *
+ * The deep nodes of the Huffman shaped tree (rare symbols such as 'N',
+ * '-' and '\0') are very sparse or very dense, and a plain bit-vector
+ * spends more than a bit per position on them. With the "auto" encoding
+ * (see builder --node-encoding) each node picks its encoding by the
+ * density p of its minority bit:
+ *
+ *   p <= 1/64   sparse: sdarray of the minority bits (static_bitsequence_sdarray)
+ *   p <= 1/8    RRR (static_bitsequence_rrr02)
+ *   otherwise   plain (BitRank, or BlockedBitRank if compiled with -DBLOCKED_RANK)
+ *
+ * libcds uses 32 bit positions, thus nodes of 2^31 bits or more are
+ * always plain, as are nodes shorter than 2^14 bits. The compressed
+ * encodings are stored as libcds serializations in the page-aligned
+ * index layout and are loaded into private memory; plain nodes are used
+ * in place from the mapping.
+ */
+
+#ifndef _NODEBITVECTOR_H_
+#define _NODEBITVECTOR_H_
+
+#include "BitRank.h"
+#ifdef BLOCKED_RANK
+#include "BlockedBitRank.h"
+#endif
+
+#include <cstdio>
+#include <vector>
+#include <utility>
+#include <string>
+
+class static_bitsequence; // libcds
+
+class NodeBitVector
+{
+public:
+    // Plain bit-vector, selected at build time
+#ifdef BLOCKED_RANK
+    typedef BlockedBitRank Plain;
+#else
+    typedef BitRank Plain;
+#endif
+
+    // Encoding of a node, stored in its HuffWT::NodeRecord (0 in older indexes)
+    enum Encoding { ENCODING_PLAIN, ENCODING_RRR, ENCODING_SPARSE };
+    static char const * encodingName(Encoding);
+
+    // Encoding of new bit-vectors: all plain, or chosen by density
+    enum Policy { POLICY_PLAIN, POLICY_AUTO };
+    static Policy policy;
+    // Set the policy by name: "plain" or "auto"
+    static bool usePolicy(std::string const &);
+
+    NodeBitVector();
+    ~NodeBitVector();
+
+    // Build from the bit-array B of length n with the given number of 1-bits; B is deleted
+    void build(ulong *, ulong, ulong);
+    void load(std::FILE *);
+    // Load with the encoding and complement flag of the node record
+    void load(MemoryMap const &, BitRank::Record const &, uchar, uchar, bool, SelectHints::Record const *);
+    // Write the sections, fill in the records, the encoding and the complement flag
+    void save(std::FILE *, BitRank::Record &, SelectHints::Record &, uchar &, uchar &);
+
+    inline Encoding encoding() const
+    { return (Encoding)enc; }
+    // Size of the compressed encoding in bytes, 0 for plain
+    ulong compressedSize() const;
+
+    inline ulong rank(ulong i) const // Rank from 0 to n-1, rank(-1) = 0
+    {
+        if (plain)
+            return plain->rank(i);
+        return compressedRank(i);
+    }
+    inline ulong select(ulong x) const // gives the position of the x:th 1.
+    {
+        if (plain)
+            return plain->select(x);
+        return compressedSelect(x, true);
+    }
+    inline ulong select0(ulong x) const // gives the position of the x:th 0.
+    {
+        if (plain)
+            return plain->select0(x);
+        return compressedSelect(x, false);
+    }
+    inline bool IsBitSet(ulong i) const
+    {
+        if (plain)
+            return plain->IsBitSet(i);
+        return compressedAccess(i);
+    }
+    // The compressed encodings are small and stay in the cache
+    inline void prefetch(ulong i) const
+    {
+        if (plain)
+            plain->prefetch(i);
+    }
+
+    // Regions of the plain bit-vector, the compressed encodings are in private memory
+    void getRegions(std::vector<std::pair<void const *, ulong> > &) const;
+
+private:
+    Plain *plain;             // 0 if compressed
+    static_bitsequence *seq;
+    ulong n;
+    uchar enc;
+    bool inverted;            // seq stores the complement (sparse encoding of a dense node)
+
+    ulong compressedRank(ulong) const;
+    ulong compressedSelect(ulong, bool) const;
+    bool compressedAccess(ulong) const;
+
+    // No copy constructor or assignment
+    NodeBitVector(NodeBitVector const&);
+    NodeBitVector& operator = (NodeBitVector const&);
+};
+
+#endif
@@ -0,0 +1,172 @@
+#include "Numa.h"
+
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <sched.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace
+{
+    const unsigned MASK_WORDS = 16; // Up to 1024 nodes
+
+    std::vector<unsigned> readList(std::string const &filename)
+    {
+        std::vector<unsigned> result;
+        std::FILE *fp = std::fopen(filename.c_str(), "r");
+        if (!fp)
+            return result;
+        char line[4096];
+        if (std::fgets(line, sizeof(line), fp))
+        {
+            // Parse "0-3,8,10-11"
+            char const *p = line;
+            while (*p >= '0' && *p <= '9')
+            {
+                unsigned a = 0, b = 0;
+                while (*p >= '0' && *p <= '9')
+                    a = 10*a + (*p++ - '0');
+                b = a;
+                if (*p == '-')
+                {
+                    b = 0;
+                    ++p;
+                    while (*p >= '0' && *p <= '9')
+                        b = 10*b + (*p++ - '0');
+                }
+                for (unsigned i = a; i <= b; ++i)
+                    result.push_back(i);
+                if (*p == ',')
+                    ++p;
+            }
+        }
+        std::fclose(fp);
+        return result;
+    }
+
+    std::vector<unsigned> nodeList()
+    {
+        std::vector<unsigned> list = readList("/sys/devices/system/node/has_memory");
+        if (list.empty())
+            list = readList("/sys/devices/system/node/online");
+        return list;
+    }
+
+    long setMempolicy(int mode, unsigned long const *mask)
+    {
+        return syscall(SYS_set_mempolicy, mode, mask, mask ? MASK_WORDS * W : 0);
+    }
+}
+
+unsigned Numa::nodes()
+{
+    std::vector<unsigned> list = nodeList();
+    return list.empty() ? 1 : list.size();
+}
+
+unsigned Numa::currentNode()
+{
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, 0) != 0)
+        return 0;
+    return node;
+}
+
+/**
+ * The given value is an index to the list of nodes with memory,
+ * i.e. 0 <= i < Numa::nodes().
+ */
+bool Numa::bindThread(unsigned i)
+{
+    std::vector<unsigned> list = nodeList();
+    if (i >= list.size())
+        return list.empty() && i == 0; // No NUMA, nothing to do
+    unsigned node = list[i];
+
+    char filename[128];
+    std::sprintf(filename, "/sys/devices/system/node/node%u/cpulist", node);
+    std::vector<unsigned> cpus = readList(filename);
+    if (cpus.empty())
+        return false;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (std::vector<unsigned>::iterator it = cpus.begin(); it != cpus.end(); ++it)
+        CPU_SET(*it, &set);
+    if (sched_setaffinity(0, sizeof(cpu_set_t), &set) != 0)
+        return false;
+
+    unsigned long mask[MASK_WORDS];
+    std::memset(mask, 0, sizeof(mask));
+    if (node >= MASK_WORDS * W)
+        return false;
+    mask[node / W] |= 1lu << (node % W);
+    return setMempolicy(MPOL_PREFERRED, mask) == 0;
+}
+
+bool Numa::interleave()
+{
+    std::vector<unsigned> list = nodeList();
+    if (list.size() <= 1)
+        return true;
+    unsigned long mask[MASK_WORDS];
+    std::memset(mask, 0, sizeof(mask));
+    for (std::vector<unsigned>::iterator it = list.begin(); it != list.end(); ++it)
+        if (*it < MASK_WORDS * W)
+            mask[*it / W] |= 1lu << (*it % W);
+    return setMempolicy(MPOL_INTERLEAVE, mask) == 0;
+}
+
+bool Numa::reset()
+{
+    return setMempolicy(MPOL_DEFAULT, 0) == 0;
+}
+
+bool Numa::bindRange(void *p, ulong length)
+{
+    int mode = MPOL_DEFAULT;
+    unsigned long mask[MASK_WORDS];
+    std::memset(mask, 0, sizeof(mask));
+    if (syscall(SYS_get_mempolicy, &mode, mask, MASK_WORDS * W, 0, 0) != 0)
+        return false;
+    if (mode == MPOL_DEFAULT)
+        return true;
+    return syscall(SYS_mbind, p, length, mode, mask, MASK_WORDS * W, 0) == 0;
+}
+
+double Numa::remoteRatio(region_vector const &regions, unsigned node, ulong samples)
+{
+    long pagesize = sysconf(_SC_PAGESIZE);
+    ulong total = 0, remote = 0;
+    std::vector<void *> pages;
+    std::vector<int> status;
+    for (region_vector::const_iterator it = regions.begin(); it != regions.end(); ++it)
+    {
+        ulong first = (ulong)it->first / pagesize;
+        ulong last = ((ulong)it->first + it->second + pagesize - 1) / pagesize;
+        if (last <= first)
+            continue;
+        ulong step = (last - first) / samples + 1;
+        pages.clear();
+        for (ulong p = first; p < last; p += step)
+            pages.push_back((void *)(p * pagesize));
+        status.assign(pages.size(), -1);
+
+        // With a null node list, move_pages() only reports the current node of each page
+        if (syscall(SYS_move_pages, 0, pages.size(), &pages[0], 0, &status[0], 0) != 0)
+            return -1.0;
+        for (std::vector<int>::iterator jt = status.begin(); jt != status.end(); ++jt)
+        {
+            if (*jt < 0)
+                continue; // Page not resident
+            ++total;
+            if ((unsigned)*jt != node)
+                ++remote;
+        }
+    }
+    if (total == 0)
+        return -1.0;
+    return (double)remote / total;
+}
@@ -0,0 +1,55 @@
+/**
+ * Minimal NUMA support for metaenumerate.
+ *
+ * Uses the Linux system calls directly (no libnuma dependency).
+ * On a system without NUMA support everything behaves as a single
+ * node machine and the calls below are no-ops.
+ */
+
+#ifndef _NUMA_H_
+#define _NUMA_H_
+
+#include "Tools.h"
+
+#include <vector>
+#include <utility>
+
+class Numa
+{
+public:
+    typedef std::vector<std::pair<void const *, ulong> > region_vector;
+
+    // Number of NUMA nodes with memory (at least 1)
+    static unsigned nodes();
+
+    // Node that the calling thread is currently running on
+    static unsigned currentNode();
+
+    /**
+     * Pin the calling thread to the CPUs of the given node and
+     * prefer memory allocations from that node.
+     */
+    static bool bindThread(unsigned);
+
+    // Interleave the memory allocations of the calling thread over all nodes
+    static bool interleave();
+
+    // Restore the default (local) memory policy of the calling thread
+    static bool reset();
+
+    /**
+     * Apply the memory policy of the calling thread to the given range
+     * (mbind), so that its pages follow the policy whichever thread
+     * touches them first.
+     */
+    static bool bindRange(void *, ulong);
+
+    /**
+     * Fraction of the resident pages in the given regions that are located
+     * on some other node than the given one. Samples at most the given
+     * number of pages per region. Returns -1 if not available.
+     */
+    static double remoteRatio(region_vector const &, unsigned, ulong = 1024);
+};
+
+#endif
@@ -0,0 +1,293 @@
+#include "RunLengthBWT.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <algorithm>
+
+namespace
+{
+    ulong * allocateBlocks(ulong words)
+    {
+        void *p = 0;
+        if (posix_memalign(&p, 64, (words ? words : 1) * sizeof(ulong)) != 0)
+            throw std::bad_alloc();
+        return (ulong *)p;
+    }
+
+    inline ulong superBlocks(ulong nblocks)
+    {
+        return (nblocks + RunLengthBWT::SUPER_BLOCKS - 1) / RunLengthBWT::SUPER_BLOCKS;
+    }
+
+    // Offset word and 32 bit counts, rounded up to a power of two
+    inline ulong recordWords(ulong sigma)
+    {
+        ulong words = 1;
+        while (words < 1 + (sigma + 1) / 2)
+            words *= 2;
+        return words;
+    }
+}
+
+const uchar RunLengthBWT::BASES[4] = {'A', 'C', 'G', 'T'};
+
+RunLengthBWT::RunLengthBWT()
+    : blocks(0), super(0), runs(0), mapped(false)
+{
+    std::memset(&dir, 0, sizeof(Directory));
+}
+
+RunLengthBWT::~RunLengthBWT()
+{
+    if (!mapped)
+    {
+        std::free(blocks);
+        delete [] super;
+        delete [] runs;
+    }
+}
+
+// Derive the code to ACGT table from the directory
+void RunLengthBWT::init()
+{
+    std::memset(base, 4, sizeof(base));
+    for (unsigned b = 0; b < 4; ++b)
+        if (dir.code[BASES[b]] != ABSENT)
+            base[dir.code[BASES[b]]] = b;
+}
+
+// Append a run of the given code and length
+void RunLengthBWT::encode(std::vector<uchar> &out, unsigned code, ulong len)
+{
+    unsigned nibble = code >= ESCAPE ? ESCAPE : code;
+    out.push_back((nibble << 4) | (len > 15 ? 15 : len - 1));
+    if (nibble == ESCAPE)
+        out.push_back(code);
+    if (len > 15)
+    {
+        len -= 16;
+        do
+        {
+            uchar b = len & 127;
+            len >>= 7;
+            out.push_back(b | (len ? 128 : 0));
+        } while (len);
+    }
+}
+
+/**
+ * Builds the structure from the given sequence of length n.
+ * The sequence is deleted.
+ */
+RunLengthBWT * RunLengthBWT::makeRunLengthBWT(uchar *s, ulong n)
+{
+    RunLengthBWT *rl = new RunLengthBWT();
+    Directory &d = rl->dir;
+    d.n = n;
+    for (ulong i = 0; i < n; ++i)
+        d.count[s[i]]++;
+    for (unsigned c = 0; c < 256; ++c)
+    {
+        d.code[c] = ABSENT;
+        if (d.count[c])
+        {
+            if (d.sigma == ABSENT)
+            {
+                delete [] s;
+                delete rl;
+                throw std::runtime_error("RunLengthBWT::makeRunLengthBWT(): too many distinct symbols.");
+            }
+            d.code[c] = d.sigma;
+            d.symbol[d.sigma++] = c;
+        }
+    }
+    d.recordWords = recordWords(d.sigma);
+
+    ulong nblocks = (n + BLOCK_SYMBOLS - 1) / BLOCK_SYMBOLS;
+    d.nblocks = nblocks;
+    rl->blocks = allocateBlocks(nblocks * d.recordWords);
+    std::memset(rl->blocks, 0, nblocks * d.recordWords * sizeof(ulong));
+    rl->super = new ulong[superBlocks(nblocks) * d.sigma];
+
+    std::vector<uchar> runs;
+    std::vector<ulong> count(d.sigma, 0);
+    ulong pos = 0;
+    for (ulong blk = 0; blk < nblocks; ++blk)
+    {
+        ulong *sb = rl->super + (blk / SUPER_BLOCKS) * d.sigma;
+        if (blk % SUPER_BLOCKS == 0)
+            for (unsigned k = 0; k < d.sigma; ++k)
+                sb[k] = count[k];
+        ulong *rec = rl->blocks + blk * d.recordWords;
+        rec[0] = runs.size();
+        uint32_t *rel = (uint32_t *)(rec + 1);
+        for (unsigned k = 0; k < d.sigma; ++k)
+            rel[k] = count[k] - sb[k];
+
+        ulong end = std::min(pos + BLOCK_SYMBOLS, n);
+        while (pos < end)
+        {
+            uchar c = s[pos];
+            ulong len = 1;
+            while (pos + len < end && s[pos + len] == c)
+                ++len;
+            unsigned code = d.code[c];
+            encode(runs, code, len);
+            count[code] += len;
+            pos += len;
+            ++d.nruns;
+        }
+    }
+    delete [] s;
+
+    d.bytes = runs.size();
+    rl->runs = new uchar[d.bytes + 1];
+    std::copy(runs.begin(), runs.end(), rl->runs);
+    rl->init();
+    std::cerr << "Run-length BWT: " << d.nruns << " runs in " << d.bytes << " bytes, "
+              << nblocks * d.recordWords * sizeof(ulong) << " bytes of block records" << std::endl;
+    return rl;
+}
+
+/**
+ * Converts an index built with HuffWT. The tree is deleted.
+ */
+RunLengthBWT * RunLengthBWT::fromHuffWT(HuffWT *wt, ulong n)
+{
+    std::cerr << "Converting HuffWT to run-length BWT..." << std::endl;
+    uchar *s = new uchar[n];
+    for (ulong i = 0; i < n; ++i)
+        s[i] = wt->access(i);
+    HuffWT::deleteHuffWT(wt);
+    return makeRunLengthBWT(s, n);
+}
+
+void RunLengthBWT::rankBatch(uchar const *c, ulong const *i, ulong *out, unsigned k) const
+{
+    for (unsigned j = 0; j < k; ++j)
+        prefetch(i[j]);
+    for (unsigned j = 0; j < k; ++j)
+        prefetchRuns(i[j]);
+    for (unsigned j = 0; j < k; ++j)
+        out[j] = rank(c[j], i[j]);
+}
+
+void RunLengthBWT::rankAllBatch(ulong const *i, ulong *out, unsigned k) const
+{
+    for (unsigned j = 0; j < k; ++j)
+        prefetch(i[j]);
+    for (unsigned j = 0; j < k; ++j)
+        prefetchRuns(i[j]);
+    for (unsigned j = 0; j < k; ++j)
+        rankAll(i[j], out + 4*j);
+}
+
+ulong RunLengthBWT::select(uchar c, ulong j) const
+{
+    unsigned code = dir.code[c];
+    if (code == ABSENT || j == 0 || j > dir.count[c])
+        return ~0lu;
+
+    // Binary search for the last block having less than j occurrences before it
+    ulong l = 0, r = dir.nblocks - 1;
+    while (l < r)
+    {
+        ulong mid = l + (r - l + 1) / 2;
+        if (before(code, mid) < j)
+            l = mid;
+        else
+            r = mid - 1;
+    }
+    j -= before(code, l);
+    uchar const *p = runs + record(l)[0];
+    ulong pos = l * BLOCK_SYMBOLS;
+    ulong end = std::min(pos + BLOCK_SYMBOLS, dir.n);
+    while (pos < end)
+    {
+        unsigned k;
+        ulong len;
+        p = decode(p, k, len);
+        if (k == code)
+        {
+            if (j <= len)
+                return pos + j - 1;
+            j -= len;
+        }
+        pos += len;
+    }
+    throw std::runtime_error("RunLengthBWT::select(): invalid count directory.");
+}
+
+/**
+ * Save in the page-aligned layout: the block records, the superblock
+ * counts and the runs, followed by the directory (FMIndex v23).
+ *
+ * Returns the file offset of the directory.
+ */
+ulong RunLengthBWT::save(RunLengthBWT *rl, std::FILE *file)
+{
+    Directory d = rl->dir;
+    d.blocks = MemoryMap::write(file, rl->blocks, d.nblocks * d.recordWords * sizeof(ulong));
+    d.super = MemoryMap::write(file, rl->super, superBlocks(d.nblocks) * d.sigma * sizeof(ulong), sizeof(ulong));
+    d.runs = MemoryMap::write(file, rl->runs, d.bytes, sizeof(ulong));
+    return MemoryMap::write(file, &d, sizeof(Directory), sizeof(ulong));
+}
+
+/**
+ * Load the page-aligned layout from the given directory offset.
+ * The arrays are used in place from the mapping unless
+ * a private copy is requested.
+ */
+RunLengthBWT * RunLengthBWT::load(MemoryMap const &mm, ulong offset, bool copy)
+{
+    RunLengthBWT *rl = new RunLengthBWT();
+    try
+    {
+        rl->dir = *mm.at<Directory>(offset, 1);
+        Directory const &d = rl->dir;
+        if (d.nblocks != (d.n + BLOCK_SYMBOLS - 1) / BLOCK_SYMBOLS || d.sigma >= ABSENT
+            || d.recordWords != recordWords(d.sigma))
+            throw std::runtime_error("RunLengthBWT::load(): invalid directory.");
+        ulong nsuper = superBlocks(d.nblocks);
+        ulong const *blocks = mm.at<ulong>(d.blocks, d.nblocks * d.recordWords);
+        ulong const *super = mm.at<ulong>(d.super, nsuper * d.sigma);
+        uchar const *runs = mm.at<uchar>(d.runs, d.bytes);
+        if (copy)
+        {
+            rl->blocks = allocateBlocks(d.nblocks * d.recordWords);
+            std::memcpy(rl->blocks, blocks, d.nblocks * d.recordWords * sizeof(ulong));
+            rl->super = new ulong[nsuper * d.sigma];
+            std::memcpy(rl->super, super, nsuper * d.sigma * sizeof(ulong));
+            rl->runs = new uchar[d.bytes + 1];
+            std::memcpy(rl->runs, runs, d.bytes);
+        }
+        else
+        {
+            rl->mapped = true;
+            rl->blocks = const_cast<ulong *>(blocks);
+            rl->super = const_cast<ulong *>(super);
+            rl->runs = const_cast<uchar *>(runs);
+        }
+        rl->init();
+    }
+    catch (...)
+    {
+        delete rl;
+        throw;
+    }
+    return rl;
+}
+
+void RunLengthBWT::getRegions(std::vector<std::pair<void const *, ulong> > &regions) const
+{
+    regions.push_back(std::make_pair((void const *)blocks, dir.nblocks * dir.recordWords * sizeof(ulong)));
+    regions.push_back(std::make_pair((void const *)super, superBlocks(dir.nblocks) * dir.sigma * sizeof(ulong)));
+    regions.push_back(std::make_pair((void const *)runs, dir.bytes));
+}
+
+void RunLengthBWT::deleteRunLengthBWT(RunLengthBWT *rl)
+{
+    delete rl;
+}
@@ -0,0 +1,235 @@
+/**
+ * Run-length compressed BWT, an alternative to HuffWT for highly
+ * repetitive collections (deep-sequenced samples with many
+ * near-identical reads have BWTs with long runs of equal symbols).
+ *
+ * The BWT is divided into blocks of 1024 symbols. The runs inside each
+ * block (a run crossing a block boundary is split) are encoded as bytes:
+ * the high nibble is the code of the symbol and the low nibble the run
+ * length minus one; nibble 15 means a longer run, and the length minus
+ * 16 follows as a varint. Codes are dense in symbol order; codes 15 and
+ * above are stored as nibble 15 followed by the code byte.
+ *
+ * Each block has a record with the offset of its runs and the number of
+ * occurrences of each code before the block (32 bits, relative to a
+ * superblock of 2^32 symbols). rank(c, i) reads the record and decodes
+ * the runs of the block up to position i, so it is fast when the runs
+ * are long; on non-repetitive data HuffWT is both smaller and faster.
+ *
+ * Interface is the same as in HuffWT; FMIndex uses this class
+ * if compiled with -DRUN_LENGTH (index version 23).
+ */
+
+#ifndef _RUNLENGTHBWT_H_
+#define _RUNLENGTHBWT_H_
+
+#include "HuffWT.h"
+
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+#include <utility>
+#include <stdint.h>
+
+class RunLengthBWT
+{
+public:
+    static const unsigned BLOCK_SYMBOLS = 1024;
+    static const ulong SUPER_BLOCKS = 1lu << 22; // relative counts fit in 32 bits
+    static const unsigned ESCAPE = 15;
+    static const uchar ABSENT = 255;             // Directory::code of absent symbols
+
+    /**
+     * Directory in the page-aligned index layout (FMIndex v23).
+     * The arrays precede the directory.
+     */
+    struct Directory
+    {
+        ulong n;
+        ulong nblocks;
+        ulong sigma;
+        ulong recordWords; // words per block record, a power of two
+        ulong nruns;       // encoded runs, split at block boundaries
+        ulong bytes;       // length of the run encoding
+        ulong count[256];
+        ulong blocks;      // file offsets
+        ulong super;
+        ulong runs;
+        uchar code[256];   // symbol to code, ABSENT if the symbol does not occur
+        uchar symbol[256]; // code to symbol
+    };
+
+    static RunLengthBWT * makeRunLengthBWT(uchar *, ulong);
+    static RunLengthBWT * fromHuffWT(HuffWT *, ulong);
+    static RunLengthBWT * load(MemoryMap const &, ulong, bool = false);
+    static ulong save(RunLengthBWT *, std::FILE *);
+    static void deleteRunLengthBWT(RunLengthBWT *);
+    void getRegions(std::vector<std::pair<void const *, ulong> > &) const;
+    ~RunLengthBWT();
+
+    inline ulong rank(uchar c, ulong i) const // returns the number of characters c before and including position i
+    {
+        unsigned code = dir.code[c];
+        if (code == ABSENT || i == ~0lu)
+            return 0;
+        ulong blk = i / BLOCK_SYMBOLS;
+        unsigned r = i % BLOCK_SYMBOLS;
+        ulong result = before(code, blk);
+        uchar const *p = runs + record(blk)[0];
+        unsigned pos = 0;
+        for (;;)
+        {
+            unsigned k;
+            ulong len;
+            p = decode(p, k, len);
+            if (pos + len > r)
+                return k == code ? result + r - pos + 1 : result;
+            if (k == code)
+                result += len;
+            pos += len;
+        }
+    }
+
+    /**
+     * rank(c, i) for c = A, C, G and T into out[0..3],
+     * with one pass over the runs of the block.
+     */
+    inline void rankAll(ulong i, ulong *out) const
+    {
+        out[0] = out[1] = out[2] = out[3] = 0;
+        if (i == ~0lu)
+            return;
+        ulong blk = i / BLOCK_SYMBOLS;
+        unsigned r = i % BLOCK_SYMBOLS;
+        ulong cnt[5] = {0, 0, 0, 0, 0};
+        uchar const *p = runs + record(blk)[0];
+        unsigned pos = 0;
+        for (;;)
+        {
+            unsigned k;
+            ulong len;
+            p = decode(p, k, len);
+            if (pos + len > r)
+            {
+                cnt[base[k]] += r - pos + 1;
+                break;
+            }
+            cnt[base[k]] += len;
+            pos += len;
+        }
+        for (unsigned b = 0; b < 4; ++b)
+            if (dir.code[BASES[b]] != ABSENT)
+                out[b] = before(dir.code[BASES[b]], blk) + cnt[b];
+    }
+
+    /**
+     * See HuffWT::rankBatch() and HuffWT::rankAllBatch(). There is only
+     * one level: the blocks of all queries are prefetched first.
+     */
+    void rankBatch(uchar const *, ulong const *, ulong *, unsigned) const;
+    void rankAllBatch(ulong const *, ulong *, unsigned) const;
+
+    ulong select(uchar, ulong) const; // position of the i:th c, i >= 1
+
+    inline bool IsCharAtPos(uchar c, ulong i) const
+    {
+        return dir.code[c] != ABSENT && access(i) == c;
+    }
+
+    inline uchar access(ulong i) const
+    {
+        ulong rank;
+        return access(i, rank);
+    }
+
+    inline uchar access(ulong i, ulong &rank) const
+    {
+        ulong blk = i / BLOCK_SYMBOLS;
+        unsigned r = i % BLOCK_SYMBOLS;
+        ulong cnt[256];
+        uchar const *p = runs + record(blk)[0];
+        unsigned pos = 0;
+        for (unsigned k = 0; k < dir.sigma; ++k)
+            cnt[k] = 0;
+        for (;;)
+        {
+            unsigned k;
+            ulong len;
+            p = decode(p, k, len);
+            if (pos + len > r)
+            {
+                rank = before(k, blk) + cnt[k] + r - pos + 1;
+                return dir.symbol[k];
+            }
+            cnt[k] += len;
+            pos += len;
+        }
+    }
+
+private:
+    static const uchar BASES[4];
+
+    Directory dir;
+    ulong *blocks;  // block records
+    ulong *super;   // counts of each code before each superblock
+    uchar *runs;
+    bool mapped;    // arrays point inside a MemoryMap
+    uchar base[256]; // code to index of ACGT, 4 for other symbols
+
+    RunLengthBWT();
+    void init();
+
+    inline ulong const * record(ulong blk) const
+    {
+        return blocks + blk * dir.recordWords;
+    }
+
+    // Occurrences of the code before the block
+    inline ulong before(unsigned code, ulong blk) const
+    {
+        uint32_t const *rel = (uint32_t const *)(record(blk) + 1);
+        return super[(blk / SUPER_BLOCKS) * dir.sigma + code] + rel[code];
+    }
+
+    // Decode the run at p, returns the position of the next run
+    static inline uchar const * decode(uchar const *p, unsigned &code, ulong &len)
+    {
+        uchar h = *p++;
+        code = h >> 4;
+        if (code == ESCAPE)
+            code = *p++;
+        len = (h & 15) + 1;
+        if (len == 16)
+        {
+            unsigned shift = 0;
+            uchar b;
+            do
+            {
+                b = *p++;
+                len += (ulong)(b & 127) << shift;
+                shift += 7;
+            } while (b & 128);
+        }
+        return p;
+    }
+
+    static void encode(std::vector<uchar> &, unsigned, ulong);
+
+    // Prefetch the record of the block; the runs can be prefetched once it has arrived
+    inline void prefetch(ulong i) const
+    {
+        if (i != ~0lu)
+            __builtin_prefetch(record(i / BLOCK_SYMBOLS));
+    }
+    inline void prefetchRuns(ulong i) const
+    {
+        if (i != ~0lu)
+            __builtin_prefetch(runs + record(i / BLOCK_SYMBOLS)[0]);
+    }
+
+    // No copy constructor or assignment
+    RunLengthBWT(RunLengthBWT const&);
+    RunLengthBWT& operator = (RunLengthBWT const&);
+};
+
+#endif
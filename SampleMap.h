@@ -0,0 +1,125 @@
+/**
+ * Samples of a pooled index (see indexmerge).
+ *
+ * The sample id of each text is stored in the order of the
+ * end-markers in BWT, as the document ids of ArrayDoc, so that
+ * a suffix that is followed backwards to the start of its text
+ * (see FMIndex::countPerSample()) finds its sample by the rank
+ * of the end-marker. Saved next to the index as <index>.samples.
+ */
+
+#ifndef _SAMPLEMAP_H_
+#define _SAMPLEMAP_H_
+
+#include "ArrayDoc.h"
+#include "BlockArray.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+// Suffix of the sample file, after the index file name
+const std::string SAMPLEMAP_EXTENSION = ".samples";
+
+class SampleMap
+{
+public:
+    // Sample ids of the end-markers, ids index the names
+    SampleMap(std::vector<std::string> const &names_, std::vector<unsigned> const &ids)
+        : names(names_), doc(0)
+    {
+        ulong bits = Tools::CeilLog2(names.size());
+        BlockArray *data = new BlockArray(ids.size(), bits ? bits : 1);
+        for (ulong i = 0; i < ids.size(); ++i)
+            (*data)[i] = ids[i];
+        doc = new ArrayDoc(data);
+    }
+
+    /**
+     * Load from the given file
+     *
+     * Throws a std::runtime_error exception on i/o error.
+     */
+    explicit SampleMap(std::string const &filename)
+        : doc(0)
+    {
+        std::FILE *file = std::fopen(filename.c_str(), "rb");
+        if (!file)
+            throw std::runtime_error("SampleMap::SampleMap(): unable to open " + filename + ".");
+        try
+        {
+            ulong count = 0;
+            if (std::fread(&count, sizeof(ulong), 1, file) != 1)
+                throw std::runtime_error("SampleMap::SampleMap(): file read error (count).");
+            for (ulong i = 0; i < count; ++i)
+            {
+                ulong length = 0;
+                if (std::fread(&length, sizeof(ulong), 1, file) != 1)
+                    throw std::runtime_error("SampleMap::SampleMap(): file read error (name).");
+                std::string name(length, ' ');
+                if (length && std::fread(&name[0], 1, length, file) != length)
+                    throw std::runtime_error("SampleMap::SampleMap(): file read error (name).");
+                names.push_back(name);
+            }
+            doc = new ArrayDoc(file);
+        }
+        catch (...)
+        {
+            std::fclose(file);
+            throw;
+        }
+        std::fclose(file);
+    }
+
+    ~SampleMap()
+    {
+        delete doc;
+    }
+
+    /**
+     * Save into the given file
+     *
+     * Throws a std::runtime_error exception on i/o error.
+     */
+    void save(std::string const &filename) const
+    {
+        std::FILE *file = std::fopen(filename.c_str(), "wb");
+        if (!file)
+            throw std::runtime_error("SampleMap::save(): unable to open " + filename + ".");
+        ulong count = names.size();
+        bool ok = std::fwrite(&count, sizeof(ulong), 1, file) == 1;
+        for (ulong i = 0; ok && i < count; ++i)
+        {
+            ulong length = names[i].size();
+            ok = std::fwrite(&length, sizeof(ulong), 1, file) == 1
+                && std::fwrite(names[i].data(), 1, length, file) == length;
+        }
+        if (!ok)
+        {
+            std::fclose(file);
+            throw std::runtime_error("SampleMap::save(): file write error (names).");
+        }
+        doc->save(file);
+        if (std::fclose(file) != 0)
+            throw std::runtime_error("SampleMap::save(): file write error.");
+    }
+
+    inline unsigned numberOfSamples() const
+    { return names.size(); }
+    inline std::string const & name(unsigned i) const
+    { return names[i]; }
+    // Sample of the text of the given end-marker (rank among the end-markers in BWT)
+    inline unsigned sample(ulong endmarkerRank)
+    { return doc->access(endmarkerRank); }
+
+private:
+    std::vector<std::string> names;
+    ArrayDoc *doc;
+
+    // No copy constructor or assignment
+    SampleMap(SampleMap const&);
+    SampleMap& operator = (SampleMap const&);
+};
+
+#endif
@@ -0,0 +1,117 @@
+#include "SelectHints.h"
+
+#include <cstring>
+#include <stdexcept>
+
+ulong SelectHints::sample = SelectHints::DEFAULT_SAMPLE;
+
+SelectHints::SelectHints()
+    : k(0), ones(0), zeros(0), nones(0), nzeros(0), mapped(false)
+{ }
+
+SelectHints::~SelectHints()
+{
+    clear();
+}
+
+void SelectHints::clear()
+{
+    if (!mapped)
+    {
+        delete [] ones;
+        delete [] zeros;
+    }
+    k = 0;
+    ones = zeros = 0;
+    nones = nzeros = 0;
+    mapped = false;
+}
+
+void SelectHints::build(ulong const *data, ulong n, ulong k_, unsigned blockBits, unsigned blockWords, unsigned skipWords)
+{
+    clear();
+    // Block numbers are stored in 32 bits
+    if (k_ == 0 || n / blockBits >= (1lu << 32))
+        return;
+
+    std::vector<uint32_t> h1, h0;
+    ulong c1 = 0, c0 = 0;        // 1- and 0-bits before the current word
+    ulong next1 = 1, next0 = 1;  // next sampled 1- and 0-bit
+    unsigned perBlock = blockBits / W;
+    for (ulong j = 0; j * W < n; ++j)
+    {
+        ulong x = data[(j / perBlock) * blockWords + skipWords + j % perBlock];
+        ulong len = n - j * W < W ? n - j * W : W;
+        if (len < W)
+            x &= (1lu << len) - 1;
+        ulong pc = __builtin_popcountl(x);
+        uint32_t block = (j * W) / blockBits;
+        for (; next1 <= c1 + pc; next1 += k_)
+            h1.push_back(block);
+        for (; next0 <= c0 + len - pc; next0 += k_)
+            h0.push_back(block);
+        c1 += pc;
+        c0 += len - pc;
+    }
+
+    k = k_;
+    nones = h1.size();
+    nzeros = h0.size();
+    ones = new uint32_t[nones + 1];
+    zeros = new uint32_t[nzeros + 1];
+    if (nones)
+        std::memcpy(ones, &h1[0], nones * sizeof(uint32_t));
+    if (nzeros)
+        std::memcpy(zeros, &h0[0], nzeros * sizeof(uint32_t));
+}
+
+/**
+ * Use the hints in place from the memory mapped index file,
+ * or make a private copy of them. The number of 1-bits in
+ * the bit-vector and its length determine the array sizes.
+ */
+void SelectHints::load(MemoryMap const &mm, Record const &r, ulong numberOfOnes, ulong n, bool copy)
+{
+    clear();
+    if (r.sample == 0)
+        return;
+    ulong n1 = (numberOfOnes + r.sample - 1) / r.sample;
+    ulong n0 = (n - numberOfOnes + r.sample - 1) / r.sample;
+    uint32_t *h1 = mm.at<uint32_t>(r.ones, n1);
+    uint32_t *h0 = mm.at<uint32_t>(r.zeros, n0);
+    k = r.sample;
+    nones = n1;
+    nzeros = n0;
+    if (!copy)
+    {
+        ones = h1;
+        zeros = h0;
+        mapped = true;
+        return;
+    }
+    ones = new uint32_t[n1 + 1];
+    zeros = new uint32_t[n0 + 1];
+    std::memcpy(ones, h1, n1 * sizeof(uint32_t));
+    std::memcpy(zeros, h0, n0 * sizeof(uint32_t));
+}
+
+/**
+ * Write the hints as page-aligned sections and fill in the record
+ */
+void SelectHints::save(std::FILE *file, Record &r) const
+{
+    r.sample = k;
+    r.ones = r.zeros = 0;
+    if (k == 0)
+        return;
+    r.ones = MemoryMap::write(file, ones, nones * sizeof(uint32_t));
+    r.zeros = MemoryMap::write(file, zeros, nzeros * sizeof(uint32_t));
+}
+
+void SelectHints::getRegions(std::vector<std::pair<void const *, ulong> > &regions) const
+{
+    if (k == 0)
+        return;
+    regions.push_back(std::make_pair((void const *)ones, nones * sizeof(uint32_t)));
+    regions.push_back(std::make_pair((void const *)zeros, nzeros * sizeof(uint32_t)));
+}
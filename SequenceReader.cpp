@@ -0,0 +1,565 @@
+#include "SequenceReader.h"
+
+#include <zlib.h>
+#ifdef PARALLEL_SUPPORT
+#include <omp.h>
+#endif
+
+#include <cstring>
+#include <stdexcept>
+#include <sys/stat.h>
+
+namespace
+{
+    /**
+     * Symbol tables: normal maps valid symbols to upper-case and
+     * invalid ones to 0, complement swaps A-T and C-G.
+     */
+    struct Tables
+    {
+        uchar normal[256];
+        uchar complement[256];
+
+        Tables()
+        {
+            std::memset(normal, 0, sizeof(normal));
+            char const *valid = "ACGTN0123.";
+            for (char const *c = valid; *c; ++c)
+                normal[(uchar)*c] = *c;
+            char const *lower = "acgtn";
+            for (char const *c = lower; *c; ++c)
+                normal[(uchar)*c] = *c - 'a' + 'A';
+
+            for (unsigned c = 0; c < 256; ++c)
+                complement[c] = c;
+            complement['A'] = 'T';
+            complement['T'] = 'A';
+            complement['C'] = 'G';
+            complement['G'] = 'C';
+        }
+    };
+
+    const Tables tables;
+
+    // Largest BGZF block, before and after decompression
+    const ulong BGZF_BLOCK_SIZE = 65536;
+
+    inline unsigned littleEndian16(uchar const *p)
+    {
+        return p[0] | (p[1] << 8);
+    }
+
+    inline unsigned littleEndian32(uchar const *p)
+    {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned)p[3] << 24);
+    }
+
+    // Title of a header line: skip the marker and white-space, end at the next white-space
+    void parseTitle(std::string const &row, std::string &title)
+    {
+        std::size_t first = row.find_first_not_of(" \t", 1);
+        if (first != std::string::npos)
+            title = row.substr(first, row.find_first_of(" \t", first) - first);
+    }
+
+    // Decompress a raw deflate stream of known size, check the CRC
+    bool inflateBlock(uchar const *data, ulong length, uchar *out, unsigned size, unsigned crc)
+    {
+        uchar empty;
+        z_stream s;
+        std::memset(&s, 0, sizeof(z_stream));
+        if (inflateInit2(&s, -15) != Z_OK)
+            return false;
+        s.next_in = (Bytef *)data;
+        s.avail_in = length;
+        s.next_out = size ? out : &empty;
+        s.avail_out = size ? size : 1;
+        bool ok = inflate(&s, Z_FINISH) == Z_STREAM_END && s.total_out == size;
+        inflateEnd(&s);
+        return ok && crc32(0, out, size) == crc;
+    }
+}
+
+SequenceReader::SequenceReader(std::FILE *file_)
+    : file(file_), block(new uchar[BLOCK_SIZE]), pos(0), end(0), eof(false), consumed(0), started(false),
+      type(FORMAT_FASTA), packing(COMPRESSION_NONE), raw(0), rawPos(0), rawEnd(0), rawEof(false),
+      zs(0), memberEnd(false), batch(), threads(1),
+      trimThreshold(0), qualityOffset(33), minLength(1), trimmed(0), skipped(0),
+      title(), seq(0), len(0), capacity(0), invalid(), quality()
+{
+#ifdef PARALLEL_SUPPORT
+    threads = omp_get_max_threads();
+#endif
+}
+
+SequenceReader::~SequenceReader()
+{
+    if (zs)
+        inflateEnd(zs);
+    delete zs;
+    delete [] raw;
+    delete [] block;
+    delete [] seq;
+}
+
+void SequenceReader::setTrimming(unsigned threshold, unsigned offset, ulong minLength_)
+{
+    trimThreshold = threshold;
+    qualityOffset = offset;
+    minLength = minLength_ ? minLength_ : 1;
+}
+
+char const * SequenceReader::formatName(Format f)
+{
+    return f == FORMAT_FASTQ ? "FASTQ" : "FASTA";
+}
+
+char const * SequenceReader::compressionName(Compression c)
+{
+    switch (c)
+    {
+    case COMPRESSION_GZIP: return "gzip";
+    case COMPRESSION_BGZF: return "bgzip";
+    default: return "none";
+    }
+}
+
+/**
+ * Read the first block and recognize the compression by the gzip
+ * magic bytes, and BGZF by the 'BC' subfield in the extra field.
+ */
+void SequenceReader::start()
+{
+    ulong n = std::fread(block, 1, BLOCK_SIZE, file);
+    if (std::ferror(file))
+        throw std::runtime_error("SequenceReader::start(): unable to read the input.");
+    if (n < 2 || block[0] != 0x1f || block[1] != 0x8b)
+    {
+        packing = COMPRESSION_NONE;
+        end = n;
+        eof = n < BLOCK_SIZE;
+        return;
+    }
+
+    if (!raw)
+        raw = new uchar[BLOCK_SIZE];
+    std::memcpy(raw, block, n);
+    rawPos = 0;
+    rawEnd = n;
+    rawEof = n < BLOCK_SIZE;
+    if (n >= 18 && (block[3] & 4) && block[12] == 'B' && block[13] == 'C' && littleEndian16(block + 14) == 2)
+        packing = COMPRESSION_BGZF;
+    else
+    {
+        packing = COMPRESSION_GZIP;
+        zs = new z_stream;
+        std::memset(zs, 0, sizeof(z_stream));
+        if (inflateInit2(zs, 15 + 16) != Z_OK)
+            throw std::runtime_error("SequenceReader::start(): unable to initialize zlib.");
+        memberEnd = false;
+    }
+}
+
+// Read the next input block, returns false at the end of the input
+bool SequenceReader::fill()
+{
+    pos = end = 0;
+    bool first = !started;
+    if (first)
+    {
+        started = true;
+        start();
+    }
+    if (packing != COMPRESSION_NONE)
+    {
+        while (end == 0 && !eof)
+            end = packing == COMPRESSION_GZIP ? inflateGzip() : inflateBgzf();
+    }
+    else if (!first && !eof)
+    {
+        end = std::fread(block, 1, BLOCK_SIZE, file);
+        if (std::ferror(file))
+            throw std::runtime_error("SequenceReader::fill(): unable to read the input.");
+        eof = end < BLOCK_SIZE;
+    }
+    consumed += end;
+    if (first && end > 0 && block[0] == '@')
+        type = FORMAT_FASTQ;
+    return end > 0;
+}
+
+// Move the remaining compressed input to the front and read more
+ulong SequenceReader::fillRaw()
+{
+    std::memmove(raw, raw + rawPos, rawEnd - rawPos);
+    rawEnd -= rawPos;
+    rawPos = 0;
+    if (!rawEof)
+    {
+        ulong n = std::fread(raw + rawEnd, 1, BLOCK_SIZE - rawEnd, file);
+        if (std::ferror(file))
+            throw std::runtime_error("SequenceReader::fillRaw(): unable to read the input.");
+        rawEof = n < BLOCK_SIZE - rawEnd;
+        rawEnd += n;
+    }
+    return rawEnd;
+}
+
+/**
+ * Decompress the next block from gzip input; concatenated
+ * members are decompressed as one stream, as by gunzip.
+ */
+ulong SequenceReader::inflateGzip()
+{
+    zs->next_out = block;
+    zs->avail_out = BLOCK_SIZE;
+    while (zs->avail_out > 0)
+    {
+        if (rawPos == rawEnd && fillRaw() == 0)
+            break;
+        if (memberEnd)
+        {
+            inflateReset(zs);
+            memberEnd = false;
+        }
+        zs->next_in = raw + rawPos;
+        zs->avail_in = rawEnd - rawPos;
+        int r = inflate(zs, Z_NO_FLUSH);
+        rawPos = rawEnd - zs->avail_in;
+        if (r == Z_STREAM_END)
+            memberEnd = true;
+        else if (r != Z_OK && r != Z_BUF_ERROR)
+            throw std::runtime_error("SequenceReader::inflateGzip(): invalid gzip input.");
+    }
+    ulong n = BLOCK_SIZE - zs->avail_out;
+    if (n == 0)
+    {
+        eof = true;
+        if (!memberEnd)
+            throw std::runtime_error("SequenceReader::inflateGzip(): gzip input is truncated.");
+    }
+    return n;
+}
+
+/**
+ * Decompress a batch of BGZF blocks, as many as fit into the input
+ * block. The blocks are independent, so they are decompressed in parallel.
+ */
+ulong SequenceReader::inflateBgzf()
+{
+    if (!rawEof && rawEnd - rawPos < BLOCK_SIZE / 2)
+        fillRaw();
+
+    batch.clear();
+    ulong out = 0;
+    while (out + BGZF_BLOCK_SIZE <= BLOCK_SIZE && rawPos < rawEnd)
+    {
+        uchar const *h = raw + rawPos;
+        ulong avail = rawEnd - rawPos;
+        if (avail < 18 || avail < 12 + littleEndian16(h + 10))
+        {
+            if (rawEof)
+                throw std::runtime_error("SequenceReader::inflateBgzf(): bgzip input is truncated.");
+            break; // The rest of the block is read with the next batch
+        }
+        if (h[0] != 0x1f || h[1] != 0x8b || h[2] != 8 || !(h[3] & 4))
+            throw std::runtime_error("SequenceReader::inflateBgzf(): invalid bgzip input.");
+
+        // Block size from the 'BC' subfield
+        ulong xlen = littleEndian16(h + 10);
+        ulong bsize = 0;
+        for (ulong i = 12; i + 4 <= 12 + xlen; i += 4 + littleEndian16(h + i + 2))
+            if (h[i] == 'B' && h[i+1] == 'C' && littleEndian16(h + i + 2) == 2 && i + 6 <= 12 + xlen)
+                bsize = littleEndian16(h + i + 4) + 1;
+        if (bsize < 12 + xlen + 8)
+            throw std::runtime_error("SequenceReader::inflateBgzf(): invalid bgzip input.");
+        if (avail < bsize)
+        {
+            if (rawEof)
+                throw std::runtime_error("SequenceReader::inflateBgzf(): bgzip input is truncated.");
+            break;
+        }
+
+        BgzfBlock b;
+        b.data = h + 12 + xlen;
+        b.length = bsize - 12 - xlen - 8;
+        b.crc = littleEndian32(h + bsize - 8);
+        b.size = littleEndian32(h + bsize - 4);
+        b.output = out;
+        if (b.size > BGZF_BLOCK_SIZE)
+            throw std::runtime_error("SequenceReader::inflateBgzf(): invalid bgzip input.");
+        batch.push_back(b);
+        out += b.size;
+        rawPos += bsize;
+    }
+    if (batch.empty())
+    {
+        eof = true;
+        return 0;
+    }
+
+    std::vector<char> ok(batch.size(), 0);
+#ifdef PARALLEL_SUPPORT
+    #pragma omp parallel for num_threads(threads) schedule(dynamic)
+#endif
+    for (long i = 0; i < (long)batch.size(); ++i)
+        ok[i] = inflateBlock(batch[i].data, batch[i].length, block + batch[i].output, batch[i].size, batch[i].crc);
+    for (ulong i = 0; i < batch.size(); ++i)
+        if (!ok[i])
+            throw std::runtime_error("SequenceReader::inflateBgzf(): invalid bgzip block (CRC or size mismatch).");
+    return out;
+}
+
+// Append normalized symbols to the sequence buffer
+void SequenceReader::append(uchar const *s, ulong n)
+{
+    if (len + n > capacity)
+    {
+        ulong c = capacity ? 2 * capacity : BLOCK_SIZE;
+        while (c < len + n)
+            c *= 2;
+        uchar *t = new uchar[c];
+        std::memcpy(t, seq, len);
+        delete [] seq;
+        seq = t;
+        capacity = c;
+    }
+    uchar *out = seq + len;
+    for (ulong i = 0; i < n; ++i)
+    {
+        uchar c = tables.normal[s[i]];
+        if (!c)
+        {
+            if (invalid.find((char)s[i]) == std::string::npos)
+                invalid += (char)s[i];
+            c = 'N';
+        }
+        out[i] = c;
+    }
+    len += n;
+}
+
+/**
+ * Read a line that may continue in the next block, and append it
+ * to out unless it is 0. Returns false at the end of the input.
+ */
+bool SequenceReader::readLine(std::string *out)
+{
+    if (pos == end && !fill())
+        return false;
+    for (;;)
+    {
+        uchar const *nl = (uchar const *)std::memchr(block + pos, '\n', end - pos);
+        ulong stop = nl ? nl - block : end;
+        if (out)
+            out->append((char const *)block + pos, stop - pos);
+        pos = stop;
+        if (nl)
+        {
+            ++pos;
+            return true;
+        }
+        if (!fill())
+            return true;
+    }
+}
+
+/**
+ * Read sequence lines: up to the next header if multiline (FASTA),
+ * otherwise one line (FASTQ).
+ */
+void SequenceReader::readSequence(bool multiline)
+{
+    bool lineStart = true;
+    for (;;)
+    {
+        if (pos == end && !fill())
+            break;
+        if (multiline && lineStart && block[pos] == '>')
+            break;
+        uchar const *nl = (uchar const *)std::memchr(block + pos, '\n', end - pos);
+        ulong stop = nl ? nl - block : end;
+        append(block + pos, stop - pos);
+        pos = stop;
+        lineStart = nl != 0;
+        if (nl)
+        {
+            ++pos;
+            if (!multiline)
+                break;
+        }
+    }
+}
+
+// Cut the 3'-end that maximizes the sum of (threshold - quality), as in BWA
+void SequenceReader::trim()
+{
+    long sum = 0, best = 0;
+    ulong cut = len;
+    for (ulong i = len; i-- > 0; )
+    {
+        sum += (long)trimThreshold - ((long)(uchar)quality[i] - (long)qualityOffset);
+        if (sum < 0)
+            break;
+        if (sum > best)
+        {
+            best = sum;
+            cut = i;
+        }
+    }
+    trimmed += len - cut;
+    len = cut;
+}
+
+/**
+ * Records are parsed from the block a line at a time; a line
+ * may continue in the next block.
+ */
+bool SequenceReader::next()
+{
+    title.clear();
+    invalid.clear();
+    len = 0;
+    if (pos == end && !fill())
+        return false;
+
+    if (type == FORMAT_FASTA)
+    {
+        if (block[pos] == '>')
+        {
+            std::string row;
+            readLine(&row);
+            parseTitle(row, title);
+        }
+        readSequence(true);
+        return true;
+    }
+
+    // FASTQ, skip empty lines between the records
+    while (block[pos] == '\n' || block[pos] == '\r')
+        if (++pos == end && !fill())
+            return false;
+    if (block[pos] != '@')
+        throw std::runtime_error("SequenceReader::next(): unable to read FASTQ input: expecting four rows per read, see README.");
+    std::string row;
+    readLine(&row);
+    parseTitle(row, title);
+    readSequence(false);
+    row.clear();
+    if (!readLine(&row) || row.empty() || row[0] != '+')
+        throw std::runtime_error("SequenceReader::next(): unable to read FASTQ input: expecting four rows per read, see README.");
+    quality.clear();
+    if (!readLine(trimThreshold ? &quality : 0))
+        throw std::runtime_error("SequenceReader::next(): unable to read FASTQ input: expecting four rows per read, see README.");
+
+    if (trimThreshold)
+    {
+        if (quality.size() != len)
+            throw std::runtime_error("SequenceReader::next(): FASTQ read " + title + " has quality values of different length.");
+        trim();
+    }
+    if (len < minLength)
+    {
+        trimmed += len;
+        len = 0;
+        ++skipped;
+    }
+    return true;
+}
+
+bool SequenceReader::rewind()
+{
+    if (std::fseek(file, 0, SEEK_SET) != 0)
+        return false;
+    pos = end = 0;
+    eof = false;
+    consumed = 0;
+    started = false;
+    type = FORMAT_FASTA;
+    packing = COMPRESSION_NONE;
+    rawPos = rawEnd = 0;
+    rawEof = false;
+    if (zs)
+        inflateEnd(zs);
+    delete zs;
+    zs = 0;
+    memberEnd = false;
+    trimmed = skipped = 0;
+    return true;
+}
+
+/**
+ * The size after decompression is the ISIZE field at the end of gzip
+ * input (modulo 4 GB, of the last member only), and is extrapolated
+ * from the first batch of blocks for BGZF, whose last member is empty.
+ * The share of the sequence lines is taken from the first block.
+ */
+ulong SequenceReader::estimateLength(std::string const &filename)
+{
+    struct stat st;
+    if (filename == "-" || stat(filename.c_str(), &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+        return 0;
+    std::FILE *fp = std::fopen(filename.c_str(), "rb");
+    if (!fp)
+        return 0;
+    ulong size = st.st_size;
+    ulong total = 0, sample = 0, sequence = 0;
+    try
+    {
+        SequenceReader r(fp);
+        r.setThreads(1);
+        if (r.fill())
+        {
+            sample = r.end;
+            if (r.packing == COMPRESSION_NONE)
+                total = size;
+            else if (r.packing == COMPRESSION_BGZF)
+                total = (double)size * r.end / r.rawPos;
+            else
+            {
+                uchar isize[4];
+                if (std::fseek(fp, -4, SEEK_END) == 0 && std::fread(isize, 1, 4, fp) == 4)
+                    total = littleEndian32(isize);
+                while (total < size) // Compressed input is smaller
+                    total += 1lu << 32;
+            }
+
+            // Sequence lines of the sample: the lines that do not start with
+            // '>' in FASTA, the second line of each record in FASTQ
+            ulong line = 0;
+            bool lineStart = true, counted = false;
+            for (ulong i = 0; i < sample; ++i)
+            {
+                if (r.block[i] == '\n')
+                {
+                    ++line;
+                    lineStart = true;
+                    continue;
+                }
+                if (lineStart)
+                    counted = r.type == FORMAT_FASTQ ? line % 4 == 1 : r.block[i] != '>';
+                lineStart = false;
+                if (counted && r.block[i] != '\r')
+                    ++sequence;
+            }
+        }
+    }
+    catch (std::runtime_error const &)
+    {
+        total = 0;
+    }
+    std::fclose(fp);
+    if (sample == 0)
+        return 0;
+    return (double)total * sequence / sample;
+}
+
+void SequenceReader::writeText(uchar const *s, ulong n, uchar *out)
+{
+    for (ulong i = 0; i < n; ++i)
+        out[i] = tables.complement[s[i]];
+    out[n] = '-';
+    uchar *r = out + 2*n;
+    for (ulong i = 0; i < n; ++i)
+        r[-(long)i] = s[i];
+}
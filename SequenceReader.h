@@ -0,0 +1,173 @@
+/**
+ * Streaming reader for the builder input (FASTA or FASTQ, optionally
+ * compressed with gzip or bgzip).
+ *
+ * The input is read in large blocks and the lines of each record are
+ * copied once into a reusable sequence buffer, normalized on the way
+ * (lower-case to upper-case, invalid symbols to 'N' as in builder.cpp).
+ * The builder then writes the text to be indexed straight into the
+ * insert buffer of the index construction (see writeText()), instead of
+ * copying each read through several std::strings.
+ *
+ * Compressed input is recognized by the gzip magic bytes. Input written
+ * by bgzip (BGZF: a series of gzip members of at most 64 kB, each with
+ * its size in the header) is decompressed in batches of blocks using
+ * all OpenMP threads; other gzip files are decompressed by one thread.
+ *
+ * The format is recognized by the first symbol: FASTQ records start
+ * with '@' and have four lines (as in FastqInputReader). The reads can
+ * be trimmed by quality from the 3'-end as in BWA: the end is cut at
+ * the position that maximizes the sum of (threshold - quality) over the
+ * trimmed suffix.
+ */
+
+#ifndef _SEQUENCEREADER_H_
+#define _SEQUENCEREADER_H_
+
+#include "Tools.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct z_stream_s; // zlib
+
+class SequenceReader
+{
+public:
+    // Size of the input blocks
+    static const ulong BLOCK_SIZE = 4*1024*1024;
+
+    enum Format { FORMAT_FASTA, FORMAT_FASTQ };
+    enum Compression { COMPRESSION_NONE, COMPRESSION_GZIP, COMPRESSION_BGZF };
+
+    // Read from the given file, which is not closed
+    explicit SequenceReader(std::FILE *);
+    ~SequenceReader();
+
+    /**
+     * Trim FASTQ reads from the 3'-end by the given quality threshold
+     * (0 disables) of qualities encoded with the given offset, and skip
+     * reads that are shorter than minLength after trimming.
+     */
+    void setTrimming(unsigned threshold, unsigned offset = 33, ulong minLength = 1);
+    // Threads used to decompress BGZF input, default is omp_get_max_threads()
+    inline void setThreads(unsigned t)
+    { threads = t ? t : 1; }
+
+    /**
+     * Read the next record, returns false at the end of the input.
+     * Lines before the first FASTA header form a record with an empty title.
+     * Skipped FASTQ reads are returned with length 0.
+     *
+     * Throws a std::runtime_error exception if the input can not be read.
+     */
+    bool next();
+
+    // Title of the record: the header line up to the first white-space
+    inline std::string const & name() const
+    { return title; }
+    // Normalized sequence of the record, not zero-terminated
+    inline uchar const * sequence() const
+    { return seq; }
+    inline ulong length() const
+    { return len; }
+    // Invalid symbols of the record that were replaced by 'N'
+    inline std::string const & invalidSymbols() const
+    { return invalid; }
+    // Number of input bytes consumed so far (after decompression)
+    inline ulong bytesRead() const
+    { return consumed; }
+
+    // Known after the first call to next()
+    inline Format format() const
+    { return type; }
+    inline Compression compression() const
+    { return packing; }
+    static char const * formatName(Format);
+    static char const * compressionName(Compression);
+
+    // Statistics of the quality trimming
+    inline ulong trimmedSymbols() const
+    { return trimmed; }
+    inline ulong skippedReads() const
+    { return skipped; }
+
+    // Restart from the beginning of the input (not possible for pipes)
+    bool rewind();
+
+    /**
+     * Write the text indexed for the given sequence of length n into
+     * out[0..2n]: the sequence and its reverse complement separated
+     * by '-', all reversed. Equals
+     *     complement(s) '-' reverse(s).
+     */
+    static void writeText(uchar const *, ulong, uchar *);
+
+    /**
+     * Estimate the number of sequence symbols in the given file from
+     * its size, the size after decompression and the share of the
+     * sequence lines in the first block. Returns 0 if the file can not
+     * be read or is not a regular file (e.g. a pipe).
+     */
+    static ulong estimateLength(std::string const &);
+
+private:
+    // A BGZF block inside the raw buffer
+    struct BgzfBlock
+    {
+        uchar const *data;
+        ulong length;
+        ulong output;     // offset in the input block
+        unsigned size;    // size after decompression
+        unsigned crc;
+    };
+
+    std::FILE *file;
+    uchar *block;       // input block, block[pos..end) not parsed yet
+    ulong pos;
+    ulong end;
+    bool eof;
+    ulong consumed;
+    bool started;       // format and compression are known
+
+    Format type;
+    Compression packing;
+    uchar *raw;         // compressed input, raw[rawPos..rawEnd) not decompressed yet
+    ulong rawPos;
+    ulong rawEnd;
+    bool rawEof;
+    z_stream_s *zs;
+    bool memberEnd;     // the last gzip member is complete
+    std::vector<BgzfBlock> batch;
+    unsigned threads;
+
+    unsigned trimThreshold;
+    unsigned qualityOffset;
+    ulong minLength;
+    ulong trimmed;
+    ulong skipped;
+
+    std::string title;
+    uchar *seq;         // sequence buffer, grows as needed
+    ulong len;
+    ulong capacity;
+    std::string invalid;
+    std::string quality;
+
+    void start();
+    bool fill();
+    ulong fillRaw();
+    ulong inflateGzip();
+    ulong inflateBgzf();
+    bool readLine(std::string *);
+    void readSequence(bool);
+    void append(uchar const *, ulong);
+    void trim();
+
+    // No copy constructor or assignment
+    SequenceReader(SequenceReader const&);
+    SequenceReader& operator = (SequenceReader const&);
+};
+
+#endif
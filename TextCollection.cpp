@@ -24,13 +24,13 @@ bool fileexists(string const & filename)
     return true;
 }
 
-TextCollection * TextCollection::load(string const & filename, string const & samplefile)
+TextCollection * TextCollection::load(string const & filename, string const & samplefile, MemoryMode mode, bool verify)
 {
   // Does filename determine index type to be FM-index?
   std::size_t found = filename.rfind(FMINDEX_EXTENSION);
   if(found != string::npos)
   {
-      return new FMIndex(filename.substr(0, found), samplefile);
+      return new FMIndex(filename.substr(0, found), samplefile, mode, verify);
   }
 
   // Does filename determine index type to be RLCSA?
@@ -55,7 +55,7 @@ TextCollection * TextCollection::load(string const & filename, string const & sa
   // Does filename + FMINDEX_EXTENSION exist?
   if(fileexists(filename + FMINDEX_EXTENSION))
   {
-      return new FMIndex(filename, samplefile);
+      return new FMIndex(filename, samplefile, mode, verify);
   }
 
   return 0;
@@ -47,6 +47,12 @@ public:
     typedef std::vector<TextPosition> position_vector;
 
     enum IndexType {TYPE_FMINDEX, TYPE_RLCSA};
+    // Placement of the index arrays at load time (v18 and later):
+    // used in place from a shared read-only file mapping, or copied
+    // into private memory of the process (first touched by the loading thread),
+    // or copied into private memory backed by 2 MB huge pages.
+    enum MemoryMode {MEMORY_MAPPED, MEMORY_COPY, MEMORY_HUGEPAGES};
+    typedef std::vector<std::pair<void const *, ulong> > region_vector;
     static const std::string REVERSE_EXTENSION;
     static const std::string ROTATION_EXTENSION;
     static const std::string FMINDEX_EXTENSION;
@@ -69,6 +75,12 @@ public:
 
     // Return C[c] + rank_c(L, i) for given c and i
     virtual TextPosition LF(uchar, TextPosition) const = 0; 
+    // LF(c, i) for c = A, C, G and T into the given array of four
+    virtual void LFAll(TextPosition, TextPosition *) const = 0; 
+    // LF(c[j], i[j]) for j < k: independent queries evaluated in lockstep
+    virtual void LFBatch(uchar const *, TextPosition const *, TextPosition *, unsigned) const = 0;
+    // LFAll(i[j], out + 4*j) for j < k, in lockstep
+    virtual void LFAllBatch(TextPosition const *, TextPosition *, unsigned) const = 0;
 
     /**
      * Given suffix i and substring length l, return T[SA[i] ... SA[i]+l].
@@ -95,8 +107,19 @@ public:
      * and TextCollection::RLCSA_EXTENSION.
      * If suffix is not specified/valid, both filename extensions
      * are checked.
+     *
+     * If verify is set, the CRC-32 of each section of the file is
+     * checked (FMIndex v24 and later), which reads the whole file.
+     */
+    static TextCollection* load(std::string const &, std::string const & = "", MemoryMode = MEMORY_MAPPED,
+                                bool verify = false);
+
+    /**
+     * Address ranges of the large arrays of the index
+     * (used to report memory placement statistics).
      */
-    static TextCollection* load(std::string const &, std::string const & = "");
+    virtual void getRegions(region_vector &) const
+    { }
 
     /**
      * Save data structure into a file
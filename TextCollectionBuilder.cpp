@@ -1,12 +1,16 @@
 #include "rlcsa_builder.h"
 #include "TextCollectionBuilder.h"
 #include "FMIndex.h"
+#include "ExternalSequence.h"
 //#include "rlcsa_wrapper.h"
 
 #include <vector>
 using std::vector;
 #include <string>
 using std::string;
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
 
 // Using pimpl idiom to hide RLCSABuilder*
 struct TCBuilderRep
@@ -24,12 +28,25 @@ struct TCBuilderRep
     bool insertAllowed;
 
     vector<string> name;
+
+    // Text reserved by ReserveText(), owned if it did not fit the insert buffer
+    uchar *reserved;
+    ulong reservedLength;
+    bool reservedOwned;
+
+    // External-memory construction, if the directory is not empty
+    string externalDir;
+    ulong externalBudget;
+
+    // Existing index to append to, if not empty
+    string appendTo;
 };
 
 /**
  * Init text collection
  */
-TextCollectionBuilder::TextCollectionBuilder(unsigned samplerate, ulong estimatedInputLength, TextCollection::IndexType type)
+TextCollectionBuilder::TextCollectionBuilder(unsigned samplerate, ulong estimatedInputLength, TextCollection::IndexType type,
+                                             unsigned threads, ulong memory)
     : p_(new struct TCBuilderRep())
 {
     p_->type = type;
@@ -41,6 +58,11 @@ TextCollectionBuilder::TextCollectionBuilder(unsigned samplerate, ulong estimate
     p_->numberOfTexts = 0;
     p_->numberOfSamples = 0;
     p_->insertAllowed = true;
+    p_->reserved = 0;
+    p_->reservedLength = 0;
+    p_->reservedOwned = false;
+    p_->externalBudget = 0;
+    Tools::ResetPeakMemory();
 
     CSA::usint rlcsa_block_size = CSA::RLCSA_BLOCK_SIZE.second;
     CSA::usint rlcsa_sample_rate = 0;
@@ -49,10 +71,17 @@ TextCollectionBuilder::TextCollectionBuilder(unsigned samplerate, ulong estimate
  
     // Parameters for FM-index: 8 bytes, no samples, buffer size n/10 bytes.
     // Parameters for RLCSA: 32 bytes, samples, buffer size n/10 bytes.
-    // Buffer size is always at least 15MB:
-    if (estimatedInputLength < TEXTCOLLECTION_DEFAULT_INPUT_LENGTH)
-        estimatedInputLength = TEXTCOLLECTION_DEFAULT_INPUT_LENGTH;
-    p_->sa = new CSA::RLCSABuilder(rlcsa_block_size, rlcsa_sample_rate, estimatedInputLength/10);
+    // Buffer size is always at least 500MB, unless planned for a memory budget:
+    ulong bufferSize = 0;
+    if (memory)
+        bufferSize = PlanBuffer(estimatedInputLength, memory);
+    else
+    {
+        if (estimatedInputLength < TEXTCOLLECTION_DEFAULT_INPUT_LENGTH)
+            estimatedInputLength = TEXTCOLLECTION_DEFAULT_INPUT_LENGTH;
+        bufferSize = estimatedInputLength/10;
+    }
+    p_->sa = new CSA::RLCSABuilder(rlcsa_block_size, rlcsa_sample_rate, bufferSize, threads ? threads : 1);
     assert(p_->sa->isOk());
 }
 
@@ -62,6 +91,38 @@ TextCollectionBuilder::~TextCollectionBuilder()
     delete p_;
 }
 
+// Largest peak of the phases logged so far
+static ulong maxPeakMemory = 0;
+
+void TextCollectionBuilder::LogPeakMemory(char const *phase)
+{
+    ulong peak = Tools::PeakMemory();
+    maxPeakMemory = std::max(maxPeakMemory, peak);
+    cerr << "peak memory (" << phase << "): " << peak / (1024*1024) << " MB" << endl;
+    Tools::ResetPeakMemory();
+}
+
+ulong TextCollectionBuilder::MaxPeakMemory()
+{
+    return maxPeakMemory;
+}
+
+ulong TextCollectionBuilder::PlanBuffer(ulong n, ulong memory)
+{
+    ulong index = n ? n : memory / 2; // Unknown input: half of the budget for the index
+    ulong buffer = memory > index ? (memory - index) / 16 : 0;
+    if (n && buffer > n + n / 8)
+        buffer = n + n / 8; // Room for an underestimate, one batch for the whole input
+    return std::max(buffer, (ulong)TEXTCOLLECTION_MIN_BUFFER);
+}
+
+ulong TextCollectionBuilder::EstimatePeakMemory(ulong n, ulong buffer, ulong externalBudget)
+{
+    ulong insert = 16 * std::min(buffer, n) + n;
+    ulong bwt = externalBudget ? n / 2 + externalBudget : 2 * n;
+    return std::max(insert, bwt);
+}
+
 void TextCollectionBuilder::InsertText(uchar const * text)
 {
     if (!p_->insertAllowed)
@@ -97,15 +158,200 @@ void TextCollectionBuilder::InsertText(uchar const * text, string const &name)
     InsertText(text);
 }
 
+uchar * TextCollectionBuilder::ReserveText(ulong m)
+{
+    if (!p_->insertAllowed)
+    {
+        std::cerr << "TextCollectionBuilder::ReserveText() error: new text can not be inserted after InitTextCollection() call!" << std::endl;
+        exit(1);
+    }
+    if (m == 0)
+    {
+        std::cerr << "TextCollectionBuilder::ReserveText() error: can not index empty texts!" << std::endl;
+        exit(1);
+    }
+    assert(p_->reserved == 0);
+
+    p_->reservedLength = m;
+    p_->reserved = p_->sa->reserveSequence(m);
+    p_->reservedOwned = p_->reserved == 0;
+    if (p_->reservedOwned)
+        p_->reserved = new uchar[m+1];
+    return p_->reserved;
+}
+
+void TextCollectionBuilder::CommitText()
+{
+    assert(p_->reserved != 0);
+    ulong m = p_->reservedLength + 1;
+    if (m > p_->maxTextLength)
+        p_->maxTextLength = m;
+    p_->n += m;
+    p_->numberOfTexts ++;
+    p_->numberOfSamples += (m-1)/p_->samplerate;
+
+    if (p_->reservedOwned)
+        p_->sa->insertSequence((char*)p_->reserved, m-1, true); // deletes the text
+    else
+        p_->sa->commitSequence(m-1);
+    assert(p_->sa->isOk());
+    p_->reserved = 0;
+}
+
+void TextCollectionBuilder::CommitText(string const &name)
+{
+    p_->name.push_back(name);
+    CommitText();
+}
+
+void TextCollectionBuilder::UseExternalMemory(string const &dir, ulong budget)
+{
+    p_->externalDir = dir;
+    p_->externalBudget = budget;
+}
+
+/**
+ * Stream the BWT of the RLCSA into the temporary files in pieces
+ * of half the RAM budget, deleting the RLCSA.
+ */
+static ExternalSequence * writeBWT(CSA::RLCSABuilder *sa, string const &dir, ulong budget)
+{
+    ExternalSequence *bwt = new ExternalSequence(dir, budget);
+    CSA::RLCSA *index = sa->getRLCSA();
+    TextCollectionBuilder::LogPeakMemory("merge");
+    ulong length = index->getSize() + index->getNumberOfSequences();
+    ulong piece = budget / 2 > 0 ? budget / 2 : 1;
+    cerr << "writing the bwt of " << length << " symbols to " << dir << ".." << endl;
+    try
+    {
+        for (ulong p = 0; p < length; p += piece)
+        {
+            ulong m = length - p < piece ? length - p : piece;
+            uchar *t = index->readBWT(CSA::pair_type(p, p + m - 1));
+            bwt->append(t, m);
+            delete [] t;
+        }
+    }
+    catch (...)
+    {
+        delete index;
+        delete bwt;
+        throw;
+    }
+    delete index;
+    TextCollectionBuilder::LogPeakMemory("getBWT");
+    return bwt;
+}
+
+void TextCollectionBuilder::AppendTo(string const &indexfile)
+{
+    p_->appendTo = indexfile;
+}
+
+/**
+ * Build the index of the existing index and the new texts (see AppendTo()).
+ */
+static TextCollection * appendTexts(TCBuilderRep *p, bool storePlainText, bool color, unsigned rotationLength)
+{
+    if (p->numberOfTexts == 0)
+        throw std::runtime_error("TextCollectionBuilder::InitTextCollection(): no texts to append.");
+    p->sa->flush();
+    TextCollectionBuilder::LogPeakMemory("merge");
+    cerr << "calling rlcsa::getbwt().." << endl;
+    CSA::usint length = 0;
+    uchar *bwt = (uchar *)p->sa->getBWT(length);
+    delete p->sa;
+    p->sa = 0;
+    assert(length == p->n);
+    TextCollectionBuilder::LogPeakMemory("getBWT");
+
+    vector<string> noNames;
+    FMIndex *added = new FMIndex(bwt, (ulong)length, p->samplerate, p->numberOfTexts, p->maxTextLength,
+                                 p->numberOfSamples, noNames, false, color, rotationLength);
+
+    cerr << "loading the index " << p->appendTo << ".." << endl;
+    FMIndex *old = 0;
+    try
+    {
+        old = dynamic_cast<FMIndex *>(TextCollection::load(p->appendTo));
+    }
+    catch (...)
+    {
+        delete added;
+        throw;
+    }
+    if (old == 0)
+    {
+        delete added;
+        throw std::runtime_error("TextCollectionBuilder::InitTextCollection(): " + p->appendTo + " is not an FM-index.");
+    }
+    unsigned texts = old->getNumberOfTexts() + p->numberOfTexts;
+    ulong maxTextLength = std::max(old->getMaxTextLength(), p->maxTextLength);
+    ulong total = old->getLength() + length;
+    ExternalSequence *ext = 0;
+    uchar *merged = 0;
+    try
+    {
+        if (!p->externalDir.empty())
+            ext = new ExternalSequence(p->externalDir, p->externalBudget);
+        merged = FMIndex::mergeBWT(old, added, ext);
+    }
+    catch (...)
+    {
+        delete old;
+        delete added;
+        delete ext;
+        throw;
+    }
+    delete old;
+    delete added;
+    TextCollectionBuilder::LogPeakMemory("index merge");
+
+    cerr << "calling fmindex constructor.." << endl;
+    TextCollection *result = 0;
+    if (ext)
+        result = new FMIndex(*ext, p->samplerate, texts, maxTextLength, 
+                             p->numberOfSamples, p->name, storePlainText, color, rotationLength);
+    else
+        result = new FMIndex(merged, total, p->samplerate, texts, maxTextLength, 
+                             p->numberOfSamples, p->name, storePlainText, color, rotationLength);
+    delete ext;
+    cerr << "fmindex constructor successful.." << endl;
+    TextCollectionBuilder::LogPeakMemory("HuffWT");
+    return result;
+}
+
 TextCollection * TextCollectionBuilder::InitTextCollection(bool storePlainText, bool color, unsigned rotationLength)
 {
     p_->insertAllowed = false; // Disable future insertions
+    LogPeakMemory("ingest");
 
     TextCollection *result = 0;
     switch(p_->type) 
     {
     case(TextCollection::TYPE_FMINDEX):
     {
+        if (!p_->appendTo.empty())
+        {
+            result = appendTexts(p_, storePlainText, color, rotationLength);
+            break;
+        }
+        if (!p_->externalDir.empty() && p_->numberOfTexts > 0)
+        {
+            ExternalSequence *bwt = writeBWT(p_->sa, p_->externalDir, p_->externalBudget);
+            delete p_->sa;
+            p_->sa = 0;
+            assert(bwt->length() == p_->n);
+
+            cerr << "calling fmindex constructor (external memory).." << endl;
+            result = new FMIndex(*bwt, p_->samplerate, p_->numberOfTexts, p_->maxTextLength, 
+                                 p_->numberOfSamples, p_->name, storePlainText, color, rotationLength);
+            delete bwt;
+            cerr << "fmindex constructor successful.." << endl;
+            LogPeakMemory("HuffWT");
+            break;
+        }
+
         uchar * bwt = 0;
         CSA::usint length = 0;
         if (p_->numberOfTexts == 0)
@@ -119,11 +365,14 @@ TextCollection * TextCollectionBuilder::InitTextCollection(bool storePlainText,
         }
         else
         {
+            p_->sa->flush();
+            LogPeakMemory("merge");
             cerr << "calling rlcsa::getbwt().." << endl;
             bwt = (uchar *)p_->sa->getBWT(length);
             cerr << "rlcsa::getbwt() successful!" << endl;
             delete p_->sa;
             p_->sa = 0;
+            LogPeakMemory("getBWT");
 
             assert(length == p_->n);
         }
@@ -132,6 +381,7 @@ TextCollection * TextCollectionBuilder::InitTextCollection(bool storePlainText,
         result = new FMIndex(bwt, (ulong)length, p_->samplerate, p_->numberOfTexts, p_->maxTextLength, 
                              p_->numberOfSamples, p_->name, storePlainText, color, rotationLength);
         cerr << "fmindex constructor successful.." << endl;
+        LogPeakMemory("HuffWT");
         break;
     }
     case(TextCollection::TYPE_RLCSA):
@@ -32,6 +32,9 @@
 // Default input length, used to calculate the buffer size.
 #define TEXTCOLLECTION_DEFAULT_INPUT_LENGTH (5lu * 1024 * 1024 * 1024)
 
+// Smallest buffer planned for a memory budget.
+#define TEXTCOLLECTION_MIN_BUFFER (16lu * 1024 * 1024)
+
 
 struct TCBuilderRep; // Pimpl
     
@@ -41,9 +44,17 @@ struct TCBuilderRep; // Pimpl
 class TextCollectionBuilder
 {
 public:
+    /**
+     * The given number of threads is used by the RLCSA construction
+     * (if incbwt is compiled with MULTITHREAD_SUPPORT, see Makefile).
+     * The insert buffer is sized by PlanBuffer() if a memory budget
+     * (bytes) is given, otherwise it is a tenth of the estimated input
+     * length, at least 500 MB.
+     */
     explicit TextCollectionBuilder(unsigned samplerate = TEXTCOLLECTION_DEFAULT_SAMPLERATE, 
                                    ulong estimatedInputLength =  TEXTCOLLECTION_DEFAULT_INPUT_LENGTH,
-                                   TextCollection::IndexType type = TextCollection::TYPE_FMINDEX);
+                                   TextCollection::IndexType type = TextCollection::TYPE_FMINDEX,
+                                   unsigned threads = 1, ulong memory = 0);
     ~TextCollectionBuilder();
         
     /** 
@@ -57,12 +68,68 @@ public:
     void InsertText(uchar const *);
     void InsertText(uchar const *, std::string const &);
 
+    /**
+     * Insert text written in place
+     *
+     * ReserveText(m) returns space for a text of m > 0 symbols from
+     * alphabet [1,255], directly in the insert buffer when it fits.
+     * CommitText() inserts the text; there can be only one reserved
+     * text at a time.
+     */
+    uchar * ReserveText(ulong);
+    void CommitText();
+    void CommitText(std::string const &);
+
+    /**
+     * Build the index in external memory: the BWT is written to
+     * temporary files in the given directory and the wavelet tree is
+     * built from there, using about the given number of bytes of RAM
+     * besides the RLCSA and the tree (see ExternalSequence).
+     */
+    void UseExternalMemory(std::string const &, ulong);
+
+    /**
+     * Append the texts to the existing index in the given file: the
+     * BWT of the new texts is merged into its BWT, the texts get the
+     * identifiers after the existing ones (see InitTextCollection()).
+     */
+    void AppendTo(std::string const &);
+
     /**
      * Init the static index
      *
      * New texts can not be inserted after this operation.
      */
     TextCollection * InitTextCollection(bool = false, bool = false, unsigned = 0);
+
+    /**
+     * Print the peak memory (RSS) of the given phase: since the
+     * previous call, or since the construction of the builder.
+     * InitTextCollection() reports its phases. The peak of the
+     * process is reset (see Tools::ResetPeakMemory()), so that
+     * getrusage() reports the last phase only; MaxPeakMemory()
+     * is the largest peak of the phases.
+     */
+    static void LogPeakMemory(char const *);
+    static ulong MaxPeakMemory();
+
+    /**
+     * Memory model of the construction, measured on DNA reads:
+     * building the RLCSA of a full insert buffer and merging it into
+     * the index take about 16 bytes per buffered symbol besides the
+     * index (at most about a byte per indexed symbol); the BWT and the
+     * wavelet tree take about two bytes per symbol, or half a byte
+     * and the RAM budget of the external-memory construction.
+     *
+     * PlanBuffer() returns the largest insert buffer (bytes) for the
+     * estimated input length (symbols, 0 if unknown) and the memory
+     * budget (bytes); the buffer is also the batch of texts that is
+     * merged into the index at a time. EstimatePeakMemory() returns
+     * the peak for the input length, buffer and external budget (0
+     * if the construction is in memory).
+     */
+    static ulong PlanBuffer(ulong, ulong);
+    static ulong EstimatePeakMemory(ulong, ulong, ulong = 0);
         
 private:
     struct TCBuilderRep * p_;
@@ -4,6 +4,7 @@
 
 #include "Tools.h"
 #include <cstdio>
+#include <string>
 
 
 time_t Tools::startTime;
@@ -93,3 +94,19 @@ unsigned Tools::bits (ulong n)
    }
 
 
+
+ulong Tools::PeakMemory()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+        if (line.compare(0, 6, "VmHWM:") == 0)
+            return std::strtoul(line.c_str() + 6, 0, 10) * 1024;
+    return 0;
+}
+
+void Tools::ResetPeakMemory()
+{
+    std::ofstream clear("/proc/self/clear_refs");
+    clear << "5" << std::endl;
+}
@@ -45,6 +45,40 @@ public:
     static unsigned FloorLog2(ulong);
     static unsigned CeilLog2(ulong);
     static unsigned bits (ulong);
+    /**
+     * Peak resident set size of the process in bytes (VmHWM), 0 if
+     * not available. ResetPeakMemory() restarts the peak from the
+     * current size, so that the peak of each phase can be measured.
+     */
+    static ulong PeakMemory();
+    static void ResetPeakMemory();
+
+    /**
+     * True if the given DNA string (ACGT) is not larger than its
+     * reverse complement, i.e. it is the canonical strand of the pair.
+     * Usually decided by the first and the last symbol.
+     */
+    static inline bool IsCanonical(uchar const *s, ulong m)
+    {
+        for (ulong i = 0; i < (m + 1) / 2; ++i)
+        {
+            uchar c = Complement(s[m-1-i]);
+            if (s[i] != c)
+                return s[i] < c;
+        }
+        return true;
+    }
+    static inline uchar Complement(uchar c)
+    {
+        switch (c)
+        {
+        case 'A': return 'T';
+        case 'C': return 'G';
+        case 'G': return 'C';
+        case 'T': return 'A';
+        }
+        return c;
+    }
 
     static inline void SetField(ulong *A, register unsigned len, register ulong index, register ulong x) 
     {
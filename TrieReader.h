@@ -24,9 +24,9 @@
 class TrieReader
 {
 public:
-    TrieReader(int i, std::string name, ServerSocket *ssocket, bool vrbs, bool dbg, bool pos = 0)
+    TrieReader(int i, std::string name, ServerSocket *ssocket, bool vrbs, bool dbg, bool pos = 0, bool cnl = false)
     : id(i), positive(pos), filename(name), ifs(ssocket), verbose(vrbs), debug(dbg), 
-        rate(time(NULL)), n(0), occs(0)
+        rate(time(NULL)), n(0), occs(0), canonical(cnl), complementLeftChar(0), complementChildren(0)
     { }
 
     bool hasChild()
@@ -74,12 +74,25 @@ public:
     char readClose() // Returns the left-char symbol
     {
         char leftChar = ifs->getc();
+        if (canonical)
+        {
+            complementLeftChar = ifs->getc();
+            complementChildren = ifs->getc();
+        }
         char c = ifs->getc();
         if (c != ')')
             perror(std::string("expecting ) byte but got ") + c);
         return leftChar;
     }
 
+    // Closing parenthesis of a node without occs and left-char (canonical mode)
+    void readBareClose()
+    {
+        char c = ifs->getc();
+        if (c != ')')
+            perror(std::string("expecting ) byte but got ") + c);
+    }
+
 
     void checkR()
     {
@@ -112,6 +125,12 @@ public:
 
     ulong getOccs()
     { return occs; }
+    // Left-char and children ('0', symbol or 'N') of the reverse
+    // complement of the last node closed in canonical mode
+    char getComplementLeftChar()
+    { return complementLeftChar; }
+    char getComplementChildren()
+    { return complementChildren; }
     int getId()
     { return id; }
     int isPositive()
@@ -226,6 +245,9 @@ protected:
     time_t rate;
     ulong n;    
     ulong occs;
+    bool canonical;
+    char complementLeftChar;
+    char complementChildren;
 private:
     TrieReader();
     // No copy constructor and assignment
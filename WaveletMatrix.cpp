@@ -0,0 +1,330 @@
+#include "WaveletMatrix.h"
+
+#include <iostream>
+#include <cstring>
+#include <new>
+
+WaveletMatrix::WaveletMatrix()
+    : bits(0)
+{
+    std::memset(&dir, 0, sizeof(Directory));
+}
+
+WaveletMatrix::~WaveletMatrix()
+{
+    if (bits)
+    {
+        for (unsigned l = 0; l < dir.levels; ++l)
+            bits[l].~BitVector();
+        ::operator delete(bits);
+    }
+}
+
+/**
+ * Builds the matrix from the given sequence of length n.
+ * The sequence is deleted.
+ */
+WaveletMatrix * WaveletMatrix::makeWaveletMatrix(uchar *s, ulong n)
+{
+    WaveletMatrix *wm = new WaveletMatrix();
+    wm->dir.n = n;
+    for (ulong i = 0; i < n; ++i)
+        wm->dir.count[s[i]]++;
+
+    // Dense codes in symbol order
+    unsigned sigma = 0;
+    for (unsigned c = 0; c < 256; ++c)
+        if (wm->dir.count[c])
+        {
+            wm->dir.code[c] = sigma;
+            wm->dir.symbol[sigma++] = c;
+        }
+    while ((1u << wm->dir.levels) < sigma)
+        ++wm->dir.levels;
+
+    for (ulong i = 0; i < n; ++i)
+        s[i] = wm->dir.code[s[i]];
+    wm->build(s);
+    return wm;
+}
+
+/**
+ * Converts an index built with HuffWT. The tree is deleted.
+ */
+WaveletMatrix * WaveletMatrix::fromHuffWT(HuffWT *wt, ulong n)
+{
+    std::cerr << "Converting HuffWT to wavelet matrix..." << std::endl;
+    uchar *s = new uchar[n];
+    for (ulong i = 0; i < n; ++i)
+        s[i] = wt->access(i);
+    HuffWT::deleteHuffWT(wt);
+    return makeWaveletMatrix(s, n);
+}
+
+/**
+ * Constructs the levels from the code sequence s, which is deleted.
+ * The sequence is stably partitioned by the bit of each level,
+ * zeros first, before constructing the next level.
+ */
+void WaveletMatrix::build(uchar *s)
+{
+    ulong n = dir.n;
+    bits = static_cast<BitVector *>(::operator new(dir.levels * sizeof(BitVector)));
+    uchar *t = new uchar[n];
+    for (unsigned l = 0; l < dir.levels; ++l)
+    {
+        std::cerr << "Constructing wavelet matrix level " << l << std::endl;
+        unsigned shift = dir.levels - 1 - l;
+        ulong *B = new ulong[n/W+1];
+        for (ulong i = 0; i < n/W+1; ++i)
+            B[i] = 0;
+        ulong zeros = 0;
+        for (ulong i = 0; i < n; ++i)
+            if ((s[i] >> shift) & 1)
+                B[i/W] |= 1lu << (i%W);
+            else
+                ++zeros;
+        dir.zeros[l] = zeros;
+
+        if (l + 1 < dir.levels)
+        {
+            ulong j = 0, k = zeros;
+            for (ulong i = 0; i < n; ++i)
+                if ((s[i] >> shift) & 1)
+                    t[k++] = s[i];
+                else
+                    t[j++] = s[i];
+            std::swap(s, t);
+        }
+        new (bits + l) BitVector(B, n, true);
+    }
+    delete [] s;
+    delete [] t;
+    computeStart();
+}
+
+/**
+ * The start position of each code at the last level
+ * is the position of an empty prefix after all levels.
+ */
+void WaveletMatrix::computeStart()
+{
+    for (unsigned code = 0; code < 256; ++code)
+    {
+        ulong i = 0;
+        for (unsigned l = 0; l < dir.levels; ++l)
+        {
+            if (code & (1u << (dir.levels - 1 - l)))
+                i = dir.zeros[l] + rank1(bits[l], i);
+            else
+                i = i - rank1(bits[l], i);
+        }
+        dir.start[code] = i;
+    }
+}
+
+/**
+ * Ranks the symbols in the mask (bit k for the k:th symbol of ACGT)
+ * from the given level on; i is the number of positions before the
+ * queried one at that level.
+ */
+void WaveletMatrix::rankAll(ulong i, unsigned mask, unsigned level, ulong *out) const
+{
+    static const uchar bases[] = {'A', 'C', 'G', 'T'};
+    for (; level < dir.levels; ++level)
+    {
+        unsigned bit = 1u << (dir.levels - 1 - level);
+        unsigned ones = 0;
+        for (unsigned k = 0; k < 4; ++k)
+            if ((mask & (1u << k)) && (dir.code[bases[k]] & bit))
+                ones |= 1u << k;
+        ulong r = rank1(bits[level], i);
+        if (ones && ones != mask)
+        {
+            rankAll(dir.zeros[level] + r, ones, level + 1, out);
+            mask &= ~ones;
+            ones = 0;
+        }
+        if (ones)
+            i = dir.zeros[level] + r;
+        else
+            i = i - r;
+    }
+    for (unsigned k = 0; k < 4; ++k)
+        if (mask & (1u << k))
+            out[k] = i - dir.start[dir.code[bases[k]]];
+}
+
+void WaveletMatrix::rankBatch(uchar const *c, ulong const *i, ulong *out, unsigned k) const
+{
+    static const unsigned MAX_BATCH = HuffWT::MAX_BATCH;
+    for (; k > MAX_BATCH; k -= MAX_BATCH, c += MAX_BATCH, i += MAX_BATCH, out += MAX_BATCH)
+        rankBatch(c, i, out, MAX_BATCH);
+    if (k == 1)
+    {
+        out[0] = rank(c[0], i[0]); // Nothing to interleave
+        return;
+    }
+
+    unsigned active[MAX_BATCH];
+    unsigned nactive = 0;
+    for (unsigned j = 0; j < k; ++j)
+    {
+        out[j] = i[j] + 1; // Number of positions before i
+        if (dir.count[c[j]] == 0)
+            out[j] = 0;
+        else
+        {
+            if (dir.levels)
+                prefetch1(bits[0], out[j]);
+            active[nactive++] = j;
+        }
+    }
+    for (unsigned l = 0; l < dir.levels; ++l)
+    {
+        BitVector const &b = bits[l];
+        unsigned bit = 1u << (dir.levels - 1 - l);
+        for (unsigned a = 0; a < nactive; ++a)
+        {
+            ulong &x = out[active[a]];
+            if (dir.code[c[active[a]]] & bit)
+                x = dir.zeros[l] + rank1(b, x);
+            else
+                x = x - rank1(b, x);
+            if (l + 1 < dir.levels)
+                prefetch1(bits[l + 1], x);
+        }
+    }
+    for (unsigned a = 0; a < nactive; ++a)
+        out[active[a]] -= dir.start[dir.code[c[active[a]]]];
+}
+
+/**
+ * Same as rankAll() with the paths of all queries in one frontier:
+ * a path splits when its symbols diverge, as in the recursion.
+ */
+void WaveletMatrix::rankAllBatch(ulong const *i, ulong *out, unsigned k) const
+{
+    static const unsigned MAX_BATCH = HuffWT::MAX_BATCH;
+    static const uchar bases[] = {'A', 'C', 'G', 'T'};
+    for (; k > MAX_BATCH; k -= MAX_BATCH, i += MAX_BATCH, out += 4*MAX_BATCH)
+        rankAllBatch(i, out, MAX_BATCH);
+    if (k == 1)
+    {
+        rankAll(i[0], out);
+        return;
+    }
+
+    struct Path
+    {
+        ulong i;
+        unsigned mask;
+        unsigned j;
+    } path[4 * MAX_BATCH];
+    unsigned mask = 0;
+    for (unsigned s = 0; s < 4; ++s)
+        if (dir.count[bases[s]])
+            mask |= 1u << s;
+    for (unsigned j = 0; j < 4*k; ++j)
+        out[j] = 0;
+    if (!mask)
+        return;
+    unsigned npaths = 0;
+    for (unsigned j = 0; j < k; ++j)
+    {
+        Path p = {i[j] + 1, mask, j};
+        if (dir.levels)
+            prefetch1(bits[0], p.i);
+        path[npaths++] = p;
+    }
+    for (unsigned l = 0; l < dir.levels; ++l)
+    {
+        BitVector const &b = bits[l];
+        unsigned bit = 1u << (dir.levels - 1 - l);
+        unsigned m = npaths;
+        for (unsigned p = 0; p < m; ++p)
+        {
+            unsigned ones = 0;
+            for (unsigned s = 0; s < 4; ++s)
+                if ((path[p].mask & (1u << s)) && (dir.code[bases[s]] & bit))
+                    ones |= 1u << s;
+            ulong r = rank1(b, path[p].i);
+            if (ones && ones != path[p].mask)
+            {
+                Path q = {dir.zeros[l] + r, ones, path[p].j};
+                if (l + 1 < dir.levels)
+                    prefetch1(bits[l + 1], q.i);
+                path[npaths++] = q;
+                path[p].mask &= ~ones;
+                ones = 0;
+            }
+            if (ones)
+                path[p].i = dir.zeros[l] + r;
+            else
+                path[p].i = path[p].i - r;
+            if (l + 1 < dir.levels)
+                prefetch1(bits[l + 1], path[p].i);
+        }
+    }
+    for (unsigned p = 0; p < npaths; ++p)
+        for (unsigned s = 0; s < 4; ++s)
+            if (path[p].mask & (1u << s))
+                out[4*path[p].j + s] = path[p].i - dir.start[dir.code[bases[s]]];
+}
+
+/**
+ * Save in the page-aligned layout: the bit-arrays of the levels
+ * followed by the directory (FMIndex v21).
+ *
+ * Returns the file offset of the directory.
+ */
+ulong WaveletMatrix::save(WaveletMatrix *wm, std::FILE *file)
+{
+    for (unsigned l = 0; l < wm->dir.levels; ++l)
+        wm->bits[l].save(file, wm->dir.bits[l], wm->dir.hints[l]);
+    return MemoryMap::write(file, &wm->dir, sizeof(Directory), sizeof(ulong));
+}
+
+/**
+ * Load the page-aligned layout from the given directory offset.
+ * The bit-arrays are used in place from the mapping unless
+ * a private copy is requested.
+ */
+WaveletMatrix * WaveletMatrix::load(MemoryMap const &mm, ulong offset, bool copy)
+{
+    WaveletMatrix *wm = new WaveletMatrix();
+    wm->dir = *mm.at<Directory>(offset, 1);
+    unsigned levels = wm->dir.levels;
+    if (levels > MAX_LEVELS)
+    {
+        delete wm;
+        throw std::runtime_error("WaveletMatrix::load(): invalid directory.");
+    }
+    wm->dir.levels = 0; // Number of constructed levels
+    wm->bits = static_cast<BitVector *>(::operator new(levels * sizeof(BitVector)));
+    try
+    {
+        for (unsigned l = 0; l < levels; ++l)
+        {
+            new (wm->bits + l) BitVector(mm, wm->dir.bits[l], copy, wm->dir.hints + l);
+            wm->dir.levels = l + 1;
+        }
+    }
+    catch (...)
+    {
+        delete wm;
+        throw;
+    }
+    return wm;
+}
+
+void WaveletMatrix::getRegions(std::vector<std::pair<void const *, ulong> > &regions) const
+{
+    for (unsigned l = 0; l < dir.levels; ++l)
+        bits[l].getRegions(regions);
+}
+
+void WaveletMatrix::deleteWaveletMatrix(WaveletMatrix *wm)
+{
+    delete wm;
+}
@@ -0,0 +1,170 @@
+/**
+ * Wavelet matrix: a pointerless, level-wise alternative to HuffWT.
+ *
+ * The symbols occurring in the sequence are mapped to dense codes
+ * 0..sigma-1 of L = ceil(log2 sigma) bits. Level l stores one bit
+ * (bit L-1-l of the code) per position; before the next level the
+ * positions are stably partitioned, zeros first. Each level is a
+ * single bit-vector of length n, the levels are stored in one array,
+ * so a query walks the same small array at each step instead of
+ * following child pointers. rank() needs one bit-vector rank per level
+ * since the start position of each symbol at the last level is stored.
+ *
+ * Interface is the same as in HuffWT; FMIndex uses this class
+ * if compiled with -DWAVELET_MATRIX (index version 21).
+ */
+
+#ifndef _WAVELETMATRIX_H_
+#define _WAVELETMATRIX_H_
+
+#include "HuffWT.h"
+
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+#include <utility>
+
+class WaveletMatrix
+{
+public:
+    // Same bit-vector class as in HuffWT (see BLOCKED_RANK)
+    typedef HuffWT::BitVector BitVector;
+
+    static const unsigned MAX_LEVELS = 8;
+
+    /**
+     * Directory in the page-aligned index layout (FMIndex v21).
+     * The bit-arrays of the levels precede the directory.
+     */
+    struct Directory
+    {
+        ulong n;
+        ulong levels;
+        ulong count[256];  // occurrences of each symbol
+        ulong start[256];  // first position of each code at the last level
+        ulong zeros[MAX_LEVELS];
+        BitRank::Record bits[MAX_LEVELS];
+        SelectHints::Record hints[MAX_LEVELS];
+        uchar code[256];   // symbol to code
+        uchar symbol[256]; // code to symbol
+    };
+
+    static WaveletMatrix * makeWaveletMatrix(uchar *, ulong);
+    static WaveletMatrix * fromHuffWT(HuffWT *, ulong);
+    static WaveletMatrix * load(MemoryMap const &, ulong, bool = false);
+    static ulong save(WaveletMatrix *, std::FILE *);
+    static void deleteWaveletMatrix(WaveletMatrix *);
+    void getRegions(std::vector<std::pair<void const *, ulong> > &) const;
+    ~WaveletMatrix();
+
+    inline ulong rank(uchar c, ulong i) const // returns the number of characters c before and including position i
+    {
+        if (dir.count[c] == 0)
+            return 0;
+        unsigned code = dir.code[c];
+        ++i; // Number of positions before i
+        for (unsigned l = 0; l < dir.levels; ++l)
+        {
+            BitVector const &b = bits[l];
+            if (code & (1u << (dir.levels - 1 - l)))
+                i = dir.zeros[l] + rank1(b, i);
+            else
+                i = i - rank1(b, i);
+        }
+        return i - dir.start[code];
+    }
+
+    /**
+     * rank(c, i) for c = A, C, G and T into out[0..3]. The levels are
+     * traversed once: positions shared by the symbols are ranked only once.
+     */
+    inline void rankAll(ulong i, ulong *out) const
+    {
+        static const uchar bases[] = {'A', 'C', 'G', 'T'};
+        unsigned mask = 0;
+        for (unsigned k = 0; k < 4; ++k)
+        {
+            out[k] = 0;
+            if (dir.count[bases[k]])
+                mask |= 1u << k;
+        }
+        if (mask)
+            rankAll(i + 1, mask, 0, out);
+    }
+
+    // See HuffWT::rankBatch() and HuffWT::rankAllBatch()
+    void rankBatch(uchar const *, ulong const *, ulong *, unsigned) const;
+    void rankAllBatch(ulong const *, ulong *, unsigned) const;
+
+    inline ulong select(uchar c, ulong i) const // position of the i:th c, i >= 1
+    {
+        if (dir.count[c] == 0 || i == 0)
+            return (ulong)-1;
+        unsigned code = dir.code[c];
+        i = dir.start[code] + i - 1;
+        for (unsigned l = dir.levels; l-- > 0; )
+        {
+            if (code & (1u << (dir.levels - 1 - l)))
+                i = bits[l].select(i - dir.zeros[l] + 1);
+            else
+                i = bits[l].select0(i + 1);
+        }
+        return i;
+    }
+
+    inline bool IsCharAtPos(uchar c, ulong i) const
+    {
+        return dir.count[c] != 0 && access(i) == c;
+    }
+
+    inline uchar access(ulong i) const
+    {
+        ulong rank;
+        return access(i, rank);
+    }
+
+    inline uchar access(ulong i, ulong &rank) const
+    {
+        unsigned code = 0;
+        for (unsigned l = 0; l < dir.levels; ++l)
+        {
+            BitVector const &b = bits[l];
+            code <<= 1;
+            if (b.IsBitSet(i))
+            {
+                code |= 1;
+                i = dir.zeros[l] + b.rank(i) - 1;
+            }
+            else
+                i = i - rank1(b, i);
+        }
+        rank = i - dir.start[code] + 1;
+        return dir.symbol[code];
+    }
+
+private:
+    Directory dir;
+    BitVector *bits; // dir.levels bit-vectors in one array
+
+    WaveletMatrix();
+
+    // Number of 1-bits before position i
+    static inline ulong rank1(BitVector const &b, ulong i)
+    {
+        return i ? b.rank(i - 1) : 0;
+    }
+    static inline void prefetch1(BitVector const &b, ulong i)
+    {
+        if (i)
+            b.prefetch(i - 1);
+    }
+    void build(uchar *);
+    void computeStart();
+    void rankAll(ulong, unsigned, unsigned, ulong *) const;
+
+    // No copy constructor or assignment
+    WaveletMatrix(WaveletMatrix const&);
+    WaveletMatrix& operator = (WaveletMatrix const&);
+};
+
+#endif
@@ -1,4 +1,9 @@
 #include "TextCollectionBuilder.h"
+#include "SelectHints.h"
+#include "BitRank.h"
+#include "NodeBitVector.h"
+#include "SequenceReader.h"
+#include "ExternalSequence.h"
 
 #include <sstream>
 #include <iostream>
@@ -8,7 +13,11 @@
 #include <ctime>
 #include <cstring>
 #include <cassert>
+#include <stdexcept>
 #include <getopt.h>
+#ifdef PARALLEL_SUPPORT
+#include <omp.h>
+#endif
 
 using namespace std;
 
@@ -16,9 +25,15 @@ using namespace std;
  * Flags set based on command line parameters
  */
 bool verbose = false;
+bool verify = false;     // Read back the section checksums after saving?
 bool color = false;      // Convert DNA to color codes?
 bool rotation = false;   // Build rotation index?
 unsigned patlen = 0;     // pattern length for rotation index
+unsigned threads = 1;    // Threads used by the construction
+string externalDir;      // External-memory construction in this directory
+ulong externalBudget = ExternalSequence::DEFAULT_BUDGET;
+string appendFile;       // Existing index to append the input to
+ulong memoryBudget = 0;  // Plan the construction for this many bytes, if given
 
 
 void revstr(std::string &t)
@@ -200,75 +215,83 @@ void transform(string &text, string const &name, bool reverse)
     revstr(text);
 }
 
-void build(istream *input, string const &outputfile, unsigned samplerate, bool reverse, ulong estimatedLength, time_t wctime)
+/**
+ * Insert the sequence of the reader. The text (see transform()) is
+ * written directly into the insert buffer, except for color codes.
+ */
+void insert(TextCollectionBuilder *tcb, SequenceReader const &input, string const &name, bool reverse)
 {
-    TextCollectionBuilder *tcb = new TextCollectionBuilder(samplerate, estimatedLength);
-    ulong j = 0;
-    unsigned i = 0;
-    string text = "";
-    string name = "undef";
-    string row;
-    while (getline(*input, row).good()) 
-    {
-	if (row[0] == '>') 
-        {
-            row = row.substr(row.find_first_not_of(" \t", 1));
-            row = row.substr(0, row.find_first_of(" \t"));
-            i ++;
-            j += text.size();
-
-            // If no title given, generate simple id numbers
-            if (row.empty())
-            {
-                stringstream ss;
-                ss << i-2;
-                row = ss.str();
-            }
-	    
-            if (verbose && i % 1000000 == 0) 
-            {
-                cerr << "Inserting: " << row << " ("
-                     << j/(1024*1024) << " MB, ";
-//                if (estimatedLength)
-//                    cerr << (100*j/estimatedLength) << "%, ";
-                cerr << "elapsed " << std::difftime(time(NULL), wctime) << " s, " 
-                     << std::difftime(time(NULL), wctime) / 3600 << " hours)" << endl;
-            }
+    if (input.invalidSymbols() != "")
+        std::cerr << "Warning: sequence " << name << " contains invalid symbol(s): " << input.invalidSymbols() << std::endl;
 
-	    if (text.size() > 0)
-            {
-                assert(name != "undef");
-                transform(text, name, reverse);
-                if (reverse)
-                    tcb->InsertText((uchar const *)text.c_str());
-                else
-                    tcb->InsertText((uchar const *)text.c_str(), name);
-            }
-            text.clear();
-            name = row; // Cache the fasta title
-	} 
-        else 
-            text.append(row);
-    }
-    // Flush the text buffer
-    j += text.size();
-    if (text.size() > 0)
+    if (color)
     {
+        string text((char const *)input.sequence(), input.length());
         transform(text, name, reverse);
         if (reverse)
             tcb->InsertText((uchar const *)text.c_str());
         else
             tcb->InsertText((uchar const *)text.c_str(), name);
+        return;
+    }
+
+    assert(!(reverse && rotation));
+    ulong m = input.length();
+    SequenceReader::writeText(input.sequence(), m, tcb->ReserveText(2*m + 1));
+    if (reverse)
+        tcb->CommitText();
+    else
+        tcb->CommitText(name);
+}
+
+void build(SequenceReader &input, string const &outputfile, unsigned samplerate, bool reverse, ulong estimatedLength, time_t wctime)
+{
+    TextCollectionBuilder *tcb = new TextCollectionBuilder(samplerate, estimatedLength, TextCollection::TYPE_FMINDEX, threads,
+                                                           memoryBudget);
+    if (!externalDir.empty())
+        tcb->UseExternalMemory(externalDir, externalBudget);
+    if (!appendFile.empty())
+        tcb->AppendTo(appendFile);
+    ulong j = 0;
+    unsigned i = 0;
+    while (input.next())
+    {
+        string name = input.name();
+        if (name.empty())
+        {
+            // If no title given, generate simple id numbers
+            stringstream ss;
+            ss << i-1;
+            name = ss.str();
+        }
+        i ++;
+        j += input.length();
+
+        if (verbose && i % 1000000 == 0) 
+        {
+            cerr << "Inserting: " << name << " ("
+                 << j/(1024*1024) << " MB, ";
+            cerr << "elapsed " << std::difftime(time(NULL), wctime) << " s, " 
+                 << std::difftime(time(NULL), wctime) / 3600 << " hours)" << endl;
+        }
+
+        if (input.length() > 0)
+            insert(tcb, input, name, reverse);
     }
-    text.clear();
-    row.clear();
 
     std::cerr << "Warning: not thread-safe" << std::endl;
 
     if (verbose)
+    {
+        std::cerr << "Read " << SequenceReader::formatName(input.format()) << " input (compression: "
+                  << SequenceReader::compressionName(input.compression()) << ")" << std::endl;
+        if (input.format() == SequenceReader::FORMAT_FASTQ)
+            std::cerr << "Quality trimming removed " << input.trimmedSymbols() << " bases, "
+                      << input.skippedReads() << " reads skipped" << std::endl;
         std::cerr << "Creating new index with " << i << " sequences, total " << j << " bytes, " << j/1024 << " kb " 
                   << "(elapsed " << std::difftime(time(NULL), wctime) << " s, " 
                   << std::difftime(time(NULL), wctime) / 3600 << " hours)" << std::endl;
+    }
 
     // TODO currently never uses plain text
     bool storePlainText = false;
@@ -281,7 +304,14 @@ void build(istream *input, string const &outputfile, unsigned samplerate, bool r
                       << "(total wall-clock time " << std::difftime(time(NULL), wctime) << " s, " 
                       << std::difftime(time(NULL), wctime) / 3600 << " hours)" << endl;
     tc->save(outputfile);
+    TextCollectionBuilder::LogPeakMemory("save");
     delete tc;
+
+    if (verify)
+    {
+        if (verbose) std::cerr << "Verifying " << outputfile << TextCollection::FMINDEX_EXTENSION << endl;
+        delete TextCollection::load(outputfile, "", TextCollection::MEMORY_MAPPED, true);
+    }
 }
 
 void print_usage(char const *name)
@@ -295,11 +325,45 @@ void print_help(char const *name)
     cerr << "usage: " << name << " [options] <input> [output]" << endl << endl
          << "<input> is the input filename. "
          << "If no output filename is given, the index is stored as <input>.fmi" << endl
-         << "or as <input>.rlcsa." << endl << endl
+         << "or as <input>.rlcsa." << endl
+         << "The input can be FASTA or FASTQ, optionally compressed with gzip or bgzip." << endl << endl
          << "Options:" << endl
          << " -s <int>, --sample-rate <int> Sampling rate for the index, a smaller number " << endl
          << "                               yields a bigger index but can decrease search " << endl
          << "                               time (default: " << TEXTCOLLECTION_DEFAULT_SAMPLERATE << ")." << endl
+         << " --select-sample <int>         Store a select hint for every <int>:th bit in the" << endl
+         << "                               wavelet tree, 0 disables (default: " << SelectHints::DEFAULT_SAMPLE << ")." << endl
+         << " --rank-layout <layout>        Rank directory of the bit-vectors: default (0.375" << endl
+         << "                               bits per bit), fast (0.25 bits per bit, one cache" << endl
+         << "                               miss less, up to 2^40 bits) or small (0.125 bits" << endl
+         << "                               per bit, up to 2^37 bits). Longer nodes fall back" << endl
+         << "                               to the next larger layout." << endl
+         << " --node-encoding <encoding>    Bit-vectors of the wavelet tree nodes: plain, or" << endl
+         << "                               auto to store sparse nodes (rare symbols)" << endl
+         << "                               compressed with RRR or sdarray (default plain)." << endl
+         << " --trim-quality <int>          Trim FASTQ reads from the 3'-end by the given" << endl
+         << "                               quality threshold as in BWA, 0 disables (default 0)." << endl
+         << " --quality-offset <int>        Offset of the FASTQ quality values (default 33)." << endl
+         << " --min-length <int>            Skip reads shorter than <int> after trimming" << endl
+         << "                               (default 1)." << endl
+         << " -t <int>, --threads <int>     Threads used by the construction and by the" << endl
+         << "                               decompression of bgzip input (default: all" << endl
+         << "                               OpenMP threads, see OMP_NUM_THREADS)." << endl
+         << " --external <dir>              Build in external memory: write the BWT into" << endl
+         << "                               temporary files in <dir> (about 2n bytes) and" << endl
+         << "                               build the wavelet tree from there." << endl
+         << " --external-memory <int>       RAM budget of the external-memory construction" << endl
+         << "                               in MB, besides the RLCSA and the wavelet tree" << endl
+         << "                               (default " << ExternalSequence::DEFAULT_BUDGET/(1024*1024) << ")." << endl
+         << " --memory <int>                Memory budget in MB: size the insert buffer (the" << endl
+         << "                               batches merged into the index) by the estimated" << endl
+         << "                               input size, and warn if the estimated peak does" << endl
+         << "                               not fit (default: 500 MB buffer)." << endl
+         << " --append <index>              Append the input to the existing index <index>" << endl
+         << "                               (.fmi) by merging the BWTs; the result replaces" << endl
+         << "                               it unless [output] is given." << endl
+         << " --verify                      Read the index back after saving it and check the" << endl
+         << "                               checksums of its sections." << endl
          << " -h, --help                    Display command line options." << endl
          << " -v, --verbose                 Print progress information." << endl;
 }
@@ -326,6 +390,11 @@ int atoi_min(char const *value, int min, char const *parameter, char const *name
 }
 
 
+enum parameter_t { long_opt_select_sample = 256, long_opt_rank_layout, long_opt_node_encoding,
+                   long_opt_trim_quality, long_opt_quality_offset, long_opt_min_length,
+                   long_opt_external, long_opt_external_memory, long_opt_append, long_opt_memory,
+                   long_opt_verify };
+
 int main(int argc, char **argv) 
 {
     std::cerr << "Warning: Reversing the string by default" << std::endl;
@@ -340,17 +409,36 @@ int main(int argc, char **argv)
     }
     unsigned samplerate = 0;
     bool reverse = false;
+    unsigned trimQuality = 0;
+    unsigned qualityOffset = 33;
+    unsigned minLength = 1;
 
     static struct option long_options[] =
         {
             {"sample-rate", required_argument, 0, 's'},
+            {"select-sample", required_argument, 0, long_opt_select_sample},
+            {"rank-layout", required_argument, 0, long_opt_rank_layout},
+            {"node-encoding", required_argument, 0, long_opt_node_encoding},
+            {"trim-quality", required_argument, 0, long_opt_trim_quality},
+            {"quality-offset", required_argument, 0, long_opt_quality_offset},
+            {"min-length", required_argument, 0, long_opt_min_length},
+            {"threads",     required_argument, 0, 't'},
+            {"external",    required_argument, 0, long_opt_external},
+            {"external-memory", required_argument, 0, long_opt_external_memory},
+            {"append",      required_argument, 0, long_opt_append},
+            {"memory",      required_argument, 0, long_opt_memory},
+            {"verify",      no_argument,       0, long_opt_verify},
             {"help",        no_argument,       0, 'h'},
             {"verbose",     no_argument,       0, 'v'},
             {0, 0, 0, 0}
         };
     int option_index = 0;
     int c;
-    while ((c = getopt_long(argc, argv, "cR:s:F:hv",
+    bool externalBudgetGiven = false;
+#ifdef PARALLEL_SUPPORT
+    threads = omp_get_max_threads();
+#endif
+    while ((c = getopt_long(argc, argv, "cR:s:F:t:hv",
                             long_options, &option_index)) != -1) 
     {
         switch(c) 
@@ -358,6 +446,53 @@ int main(int argc, char **argv)
         case 's':
             samplerate = atoi_min(optarg, 1, "-s, --sample-rate", argv[0]); 
             break;
+        case long_opt_select_sample:
+            SelectHints::sample = atoi_min(optarg, 0, "--select-sample", argv[0]);
+            break;
+        case long_opt_rank_layout:
+            if (!BitRank::useLayout(optarg))
+            {
+                cerr << "builder: argument of --rank-layout must be default, fast or small" << endl
+                     << "Check README or `" << argv[0] << " --help' for more information." << endl;
+                return 1;
+            }
+            break;
+        case long_opt_node_encoding:
+            if (!NodeBitVector::usePolicy(optarg))
+            {
+                cerr << "builder: argument of --node-encoding must be plain or auto" << endl
+                     << "Check README or `" << argv[0] << " --help' for more information." << endl;
+                return 1;
+            }
+            break;
+        case 't':
+            threads = atoi_min(optarg, 1, "-t, --threads", argv[0]);
+            break;
+        case long_opt_trim_quality:
+            trimQuality = atoi_min(optarg, 0, "--trim-quality", argv[0]);
+            break;
+        case long_opt_quality_offset:
+            qualityOffset = atoi_min(optarg, 0, "--quality-offset", argv[0]);
+            break;
+        case long_opt_min_length:
+            minLength = atoi_min(optarg, 1, "--min-length", argv[0]);
+            break;
+        case long_opt_external:
+            externalDir = optarg;
+            break;
+        case long_opt_external_memory:
+            externalBudget = (ulong)atoi_min(optarg, 1, "--external-memory", argv[0]) * 1024 * 1024;
+            externalBudgetGiven = true;
+            break;
+        case long_opt_append:
+            appendFile = optarg;
+            break;
+        case long_opt_memory:
+            memoryBudget = (ulong)atoi_min(optarg, 1, "--memory", argv[0]) * 1024 * 1024;
+            break;
+        case long_opt_verify:
+            verify = true;
+            break;
         case 'h':
             print_help(argv[0]);
             return 0;
@@ -392,13 +527,13 @@ int main(int argc, char **argv)
     if (optind != argc)
         outputfile = string(argv[optind++]);
     
-    istream *fp;
+    std::FILE *fp;
     if (inputfile == "-")
-        fp = &std::cin;
+        fp = stdin;
     else
-        fp = new std::ifstream(inputfile.c_str());
+        fp = std::fopen(inputfile.c_str(), "rb");
 
-    if (!fp->good())
+    if (!fp)
     {
         cerr << "builder: unable to read input file " << inputfile << endl;
         exit(1); 
@@ -408,26 +543,62 @@ int main(int argc, char **argv)
     cerr.precision(2);
     time_t wctime = time(NULL);
 
-    // estimate the total input sequence length
-//    fp->seekg(0, ios::end);
-    long estLength = 1; //fp->tellg();
-    if (estLength == -1)
+    // Estimate the length of the indexed text: each sequence and its reverse complement
+    ulong estLength = 0;
+    if (memoryBudget)
     {
-        cerr << "Warning: unable to estimate input file size" << endl;
-        estLength = 0;
+        estLength = 2 * SequenceReader::estimateLength(inputfile);
+        if (estLength == 0)
+            cerr << "Warning: unable to estimate input file size" << endl;
+        if (!externalDir.empty() && !externalBudgetGiven)
+            externalBudget = memoryBudget / 2;
+        ulong buffer = TextCollectionBuilder::PlanBuffer(estLength, memoryBudget);
+        ulong peak = TextCollectionBuilder::EstimatePeakMemory(estLength, buffer, externalDir.empty() ? 0 : externalBudget);
+        if (verbose)
+            cerr << "Memory plan: input about " << estLength/(1024*1024) << " M symbols, insert buffer "
+                 << buffer/(1024*1024) << " MB, estimated peak " << peak/(1024*1024) << " MB" << endl;
+        if (estLength && peak > memoryBudget)
+            cerr << "Warning: the estimated peak memory " << peak/(1024*1024) << " MB exceeds --memory"
+                 << (externalDir.empty() ? " (see --external)" : "") << endl;
     }
-//    fp->seekg(0);
     
     /**
      * Build forward/rotation index
      */
     if (verbose)
         cerr << "Building the forward index:" << endl;
+    if (outputfile == "" && appendFile != "")
+    {
+        outputfile = appendFile;
+        std::size_t found = outputfile.rfind(TextCollection::FMINDEX_EXTENSION);
+        if (found != string::npos && found + TextCollection::FMINDEX_EXTENSION.size() == outputfile.size())
+            outputfile.erase(found);
+    }
     if (outputfile == "")
         outputfile = inputfile; // suffix will be added by TextCollection::save().
     if (rotation)
         outputfile += TextCollection::ROTATION_EXTENSION;
-    build(fp, outputfile, samplerate, false, estLength, wctime);
+#ifdef PARALLEL_SUPPORT
+    omp_set_num_threads(threads);
+#else
+    if (threads > 1)
+        cerr << "Warning: compiled without PARALLEL_SUPPORT, using one thread" << endl;
+#endif
+    if (verbose)
+        cerr << "Using " << threads << " thread(s)" << endl;
+
+    SequenceReader input(fp);
+    input.setTrimming(trimQuality, qualityOffset, minLength);
+    input.setThreads(threads);
+    try
+    {
+        build(input, outputfile, samplerate, false, estLength, wctime);
+    }
+    catch (std::runtime_error const &e)
+    {
+        cerr << "builder: " << e.what() << endl;
+        return 1;
+    }
 
     if (!reverse)
     {
@@ -435,9 +606,10 @@ int main(int argc, char **argv)
         if (verbose) 
             std::cerr << "Skipping reverse indexing. Save complete. " 
                       << "(total wall-clock time " << std::difftime(time(NULL), wctime) << " s, " 
-                      << std::difftime(time(NULL), wctime) / 3600 << " hours)" << endl;
-        if (fp != &std::cin)
-            delete fp;
+                      << std::difftime(time(NULL), wctime) / 3600 << " hours, peak memory "
+                      << TextCollectionBuilder::MaxPeakMemory()/(1024*1024) << " MB)" << endl;
+        if (fp != stdin)
+            std::fclose(fp);
         fp = 0;
         return 0; // all done
     }
@@ -448,25 +620,32 @@ int main(int argc, char **argv)
     if (verbose)
         cerr << "Building the reverse index:" << endl;
     assert(!rotation);
-    fp->clear(); // forget previous EOF
-    fp->seekg(0);
-    if (!fp->good())
+    if (!input.rewind())
     {
         cerr << "builder: unable to rewind the input file!" << endl;
         return 1;
     }
 
     outputfile += TextCollection::REVERSE_EXTENSION;
-    build(fp, outputfile, samplerate, true, estLength, wctime);
+    try
+    {
+        build(input, outputfile, samplerate, true, estLength, wctime);
+    }
+    catch (std::runtime_error const &e)
+    {
+        cerr << "builder: " << e.what() << endl;
+        return 1;
+    }
 
-    if (fp != &std::cin)
-        delete fp;
+    if (fp != stdin)
+        std::fclose(fp);
     fp = 0;
 
     if (verbose) 
         std::cerr << "Save complete. "
                   << "(total wall-clock time " << std::difftime(time(NULL), wctime) << " s, " 
-                  << std::difftime(time(NULL), wctime) / 3600 << " hours)" << endl;
+                  << std::difftime(time(NULL), wctime) / 3600 << " hours, peak memory "
+                  << TextCollectionBuilder::MaxPeakMemory()/(1024*1024) << " MB)" << endl;
     return 0;
 }
  
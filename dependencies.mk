@@ -1,30 +1,59 @@
-BitRank.o: BitRank.cpp BitRank.h Tools.h
-builder.o: builder.cpp TextCollectionBuilder.h TextCollection.h Tools.h
+BitRank.o: BitRank.cpp BitRank.h Tools.h MemoryMap.h SelectHints.h \
+ BitOps.h
+BlockedBitRank.o: BlockedBitRank.cpp BlockedBitRank.h BitRank.h Tools.h \
+ MemoryMap.h SelectHints.h BitOps.h
 ClientSocket.o: ClientSocket.cpp ClientSocket.h Tools.h
+DNARank.o: DNARank.cpp DNARank.h HuffWT.h NodeBitVector.h BitRank.h \
+ Tools.h MemoryMap.h SelectHints.h ExternalSequence.h BitOps.h
 EnumerateQuery.o: EnumerateQuery.cpp EnumerateQuery.h Query.h Pattern.h \
  Tools.h InputReader.h OutputWriter.h TextCollection.h ClientSocket.h
+ExternalSequence.o: ExternalSequence.cpp ExternalSequence.h Tools.h
 FMIndex.o: FMIndex.cpp FMIndex.h TextCollection.h Tools.h BlockArray.h \
- ArrayDoc.h TextStorage.h libcds/includes/static_bitsequence.h \
- libcds/includes/basics.h libcds/includes/static_bitsequence_rrr02.h \
+ ArrayDoc.h SampleMap.h TextStorage.h \
+ libcds/includes/static_bitsequence.h libcds/includes/basics.h \
+ libcds/includes/static_bitsequence_rrr02.h \
  libcds/includes/table_offset.h \
  libcds/includes/static_bitsequence_rrr02_light.h \
  libcds/includes/static_bitsequence_naive.h \
  libcds/includes/static_bitsequence_brw32.h \
  libcds/includes/static_bitsequence_sdarray.h libcds/includes/sdarray.h \
- HuffWT.h BitRank.h ResultSet.h
-HuffWT.o: HuffWT.cpp HuffWT.h BitRank.h Tools.h
+ HuffWT.h NodeBitVector.h BitRank.h MemoryMap.h SelectHints.h \
+ ExternalSequence.h WaveletMatrix.h DNARank.h RunLengthBWT.h ResultSet.h
+HuffWT.o: HuffWT.cpp HuffWT.h NodeBitVector.h BitRank.h Tools.h \
+ MemoryMap.h SelectHints.h ExternalSequence.h
 InputReader.o: InputReader.cpp InputReader.h Pattern.h Tools.h
-metaenumerate.o: metaenumerate.cpp Query.h Pattern.h Tools.h \
- InputReader.h OutputWriter.h TextCollection.h EnumerateQuery.h \
- ClientSocket.h
-metaserver.o: metaserver.cpp TrieReader.h Tools.h ServerSocket.h
+MemoryMap.o: MemoryMap.cpp MemoryMap.h Tools.h Numa.h
+NodeBitVector.o: NodeBitVector.cpp NodeBitVector.h BitRank.h Tools.h \
+ MemoryMap.h SelectHints.h libcds/includes/static_bitsequence.h \
+ libcds/includes/basics.h libcds/includes/static_bitsequence_rrr02.h \
+ libcds/includes/table_offset.h \
+ libcds/includes/static_bitsequence_rrr02_light.h \
+ libcds/includes/static_bitsequence_naive.h \
+ libcds/includes/static_bitsequence_brw32.h \
+ libcds/includes/static_bitsequence_sdarray.h libcds/includes/sdarray.h
+Numa.o: Numa.cpp Numa.h Tools.h
 OutputWriter.o: OutputWriter.cpp OutputWriter.h Pattern.h Tools.h \
  TextCollection.h
 Pattern.o: Pattern.cpp Pattern.h Tools.h
 Query.o: Query.cpp Query.h Pattern.h Tools.h InputReader.h OutputWriter.h \
  TextCollection.h
 ResultSet.o: ResultSet.cpp ResultSet.h
+RunLengthBWT.o: RunLengthBWT.cpp RunLengthBWT.h HuffWT.h NodeBitVector.h \
+ BitRank.h Tools.h MemoryMap.h SelectHints.h ExternalSequence.h
+SelectHints.o: SelectHints.cpp SelectHints.h Tools.h MemoryMap.h
+SequenceReader.o: SequenceReader.cpp SequenceReader.h Tools.h
 ServerSocket.o: ServerSocket.cpp ServerSocket.h Tools.h
+TextCollection.o: TextCollection.cpp TextCollection.h Tools.h FMIndex.h \
+ BlockArray.h ArrayDoc.h SampleMap.h TextStorage.h \
+ libcds/includes/static_bitsequence.h libcds/includes/basics.h \
+ libcds/includes/static_bitsequence_rrr02.h \
+ libcds/includes/table_offset.h \
+ libcds/includes/static_bitsequence_rrr02_light.h \
+ libcds/includes/static_bitsequence_naive.h \
+ libcds/includes/static_bitsequence_brw32.h \
+ libcds/includes/static_bitsequence_sdarray.h libcds/includes/sdarray.h \
+ HuffWT.h NodeBitVector.h BitRank.h MemoryMap.h SelectHints.h \
+ ExternalSequence.h WaveletMatrix.h DNARank.h RunLengthBWT.h ResultSet.h
 TextCollectionBuilder.o: TextCollectionBuilder.cpp incbwt/rlcsa_builder.h \
  incbwt/rlcsa.h incbwt/bits/deltavector.h incbwt/bits/bitvector.h \
  incbwt/bits/../misc/definitions.h incbwt/bits/bitbuffer.h \
@@ -34,30 +63,47 @@ TextCollectionBuilder.o: TextCollectionBuilder.cpp incbwt/rlcsa_builder.h \
  incbwt/alphabet.h incbwt/misc/definitions.h incbwt/lcpsamples.h \
  incbwt/bits/array.h incbwt/misc/parameters.h incbwt/suffixarray.h \
  TextCollectionBuilder.h TextCollection.h Tools.h FMIndex.h BlockArray.h \
- ArrayDoc.h TextStorage.h libcds/includes/static_bitsequence.h \
- libcds/includes/basics.h libcds/includes/static_bitsequence_rrr02.h \
+ ArrayDoc.h SampleMap.h TextStorage.h \
+ libcds/includes/static_bitsequence.h libcds/includes/basics.h \
+ libcds/includes/static_bitsequence_rrr02.h \
  libcds/includes/table_offset.h \
  libcds/includes/static_bitsequence_rrr02_light.h \
  libcds/includes/static_bitsequence_naive.h \
  libcds/includes/static_bitsequence_brw32.h \
  libcds/includes/static_bitsequence_sdarray.h libcds/includes/sdarray.h \
- HuffWT.h BitRank.h ResultSet.h
-TextCollection.o: TextCollection.cpp TextCollection.h Tools.h FMIndex.h \
- BlockArray.h ArrayDoc.h TextStorage.h \
+ HuffWT.h NodeBitVector.h BitRank.h MemoryMap.h SelectHints.h \
+ ExternalSequence.h WaveletMatrix.h DNARank.h RunLengthBWT.h ResultSet.h
+TextStorage.o: TextStorage.cpp TextStorage.h TextCollection.h Tools.h \
  libcds/includes/static_bitsequence.h libcds/includes/basics.h \
  libcds/includes/static_bitsequence_rrr02.h \
  libcds/includes/table_offset.h \
  libcds/includes/static_bitsequence_rrr02_light.h \
  libcds/includes/static_bitsequence_naive.h \
  libcds/includes/static_bitsequence_brw32.h \
- libcds/includes/static_bitsequence_sdarray.h libcds/includes/sdarray.h \
- HuffWT.h BitRank.h ResultSet.h
-TextStorage.o: TextStorage.cpp TextStorage.h TextCollection.h Tools.h \
+ libcds/includes/static_bitsequence_sdarray.h libcds/includes/sdarray.h
+Tools.o: Tools.cpp Tools.h
+WaveletMatrix.o: WaveletMatrix.cpp WaveletMatrix.h HuffWT.h \
+ NodeBitVector.h BitRank.h Tools.h MemoryMap.h SelectHints.h \
+ ExternalSequence.h
+builder.o: builder.cpp TextCollectionBuilder.h TextCollection.h Tools.h \
+ SelectHints.h MemoryMap.h BitRank.h NodeBitVector.h SequenceReader.h \
+ ExternalSequence.h
+indexmerge.o: indexmerge.cpp FMIndex.h TextCollection.h Tools.h \
+ BlockArray.h ArrayDoc.h SampleMap.h TextStorage.h \
  libcds/includes/static_bitsequence.h libcds/includes/basics.h \
  libcds/includes/static_bitsequence_rrr02.h \
  libcds/includes/table_offset.h \
  libcds/includes/static_bitsequence_rrr02_light.h \
  libcds/includes/static_bitsequence_naive.h \
  libcds/includes/static_bitsequence_brw32.h \
- libcds/includes/static_bitsequence_sdarray.h libcds/includes/sdarray.h
-Tools.o: Tools.cpp Tools.h
+ libcds/includes/static_bitsequence_sdarray.h libcds/includes/sdarray.h \
+ HuffWT.h NodeBitVector.h BitRank.h MemoryMap.h SelectHints.h \
+ ExternalSequence.h WaveletMatrix.h DNARank.h RunLengthBWT.h ResultSet.h
+ingestbench.o: ingestbench.cpp SequenceReader.h Tools.h
+metaenumerate.o: metaenumerate.cpp Query.h Pattern.h Tools.h \
+ InputReader.h OutputWriter.h TextCollection.h EnumerateQuery.h \
+ ClientSocket.h Numa.h
+metaserver.o: metaserver.cpp TrieReader.h Tools.h ServerSocket.h
+rankbench.o: rankbench.cpp TextCollection.h Tools.h HuffWT.h \
+ NodeBitVector.h BitRank.h MemoryMap.h SelectHints.h ExternalSequence.h \
+ DNARank.h
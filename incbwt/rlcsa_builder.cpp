@@ -77,6 +77,31 @@ RLCSABuilder::insertSequence(char* sequence, usint length, bool delete_sequence)
   }
 }
 
+uchar*
+RLCSABuilder::reserveSequence(usint length)
+{
+  if(this->buffer == 0 || length == 0 || !this->ok) { return 0; }
+
+  #ifdef MULTITHREAD_SUPPORT
+  omp_set_num_threads(this->threads);
+  #endif
+
+  if(this->buffer_size - this->chars <= length)
+  {
+    if(this->chars > 0) { this->flush(); }
+    if(length >= this->buffer_size - 1) { return 0; }
+  }
+  return this->buffer + this->chars;
+}
+
+void
+RLCSABuilder::commitSequence(usint length)
+{
+  this->chars += length;
+  this->buffer[this->chars] = 0;
+  this->chars++;
+}
+
 void
 RLCSABuilder::insertFromFile(const std::string& base_name)
 {
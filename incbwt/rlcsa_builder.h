@@ -17,12 +17,20 @@ class RLCSABuilder
     // Note that the sequence must not contain character \0, unless buffer size is 0.
     void insertSequence(char* sequence, usint length, bool delete_sequence);
 
+    // Space for a sequence of the given length in the buffer, to be written by the caller
+    // and completed with commitSequence(). Returns 0 if the sequence does not fit the buffer.
+    uchar* reserveSequence(usint length);
+    void commitSequence(usint length);
+
     // Use this if you have already built an index for the file.
     void insertFromFile(const std::string& base_name);
 
     // Use this to build an index for the collection and merge it with the existing index.
     void insertCollection(const std::string& base_name);
 
+    // Build the buffered sequences and merge them into the index.
+    void flush();
+
     // User must free the index. Builder no longer contains it.
     RLCSA* getRLCSA();
 
@@ -56,7 +64,6 @@ class RLCSABuilder
     double sort_time;
     double merge_time;
 
-    void flush();
     void reset();
 
     void addRLCSA(RLCSA* increment, uchar* sequence, usint length, bool delete_sequence);
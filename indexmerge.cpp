@@ -0,0 +1,291 @@
+/**
+ * Merge several indexes (.fmi) into one pooled index.
+ *
+ * The BWTs are merged pairwise as a balanced tree (see
+ * FMIndex::mergeBWT()); the merges of different subtrees run in
+ * parallel. The texts of the inputs get consecutive identifiers in
+ * the order of the inputs, as if their FASTA files had been
+ * concatenated and indexed with builder.
+ *
+ * The sample of each text is kept in <output>.fmi.samples (see
+ * SampleMap), so that counts can still be split per sample. An input
+ * that has a sample file itself (a pooled index) keeps its samples,
+ * other inputs form one sample named by the file name.
+ */
+#include "FMIndex.h"
+#include "SampleMap.h"
+#include "ExternalSequence.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdlib>
+#include <ctime>
+#include <unistd.h>
+#include <getopt.h>
+#ifdef PARALLEL_SUPPORT
+#include <omp.h>
+#endif
+
+using namespace std;
+
+bool verbose = false;
+bool verify = false;     // Read back the section checksums after saving?
+unsigned threads = 1;
+string externalDir;      // External-memory construction of the result
+ulong externalBudget = ExternalSequence::DEFAULT_BUDGET;
+
+/**
+ * Index and the sample ids of its texts in the order of the end-markers in BWT
+ */
+struct Pool
+{
+    FMIndex *index;
+    vector<unsigned> samples;
+
+    Pool()
+        : index(0), samples()
+    { }
+    ~Pool()
+    { delete index; }
+};
+
+/**
+ * Load the given index, its samples get the ids after the given names
+ */
+Pool * loadPool(string const &filename, vector<string> &names)
+{
+    Pool *p = new Pool();
+    p->index = dynamic_cast<FMIndex *>(TextCollection::load(filename));
+    if (p->index == 0)
+    {
+        delete p;
+        throw std::runtime_error("indexmerge: " + filename + " is not an FM-index.");
+    }
+    unsigned texts = p->index->getNumberOfTexts();
+    string samplefile = filename + SAMPLEMAP_EXTENSION;
+    if (access(samplefile.c_str(), R_OK) == 0)
+    {
+        SampleMap map(samplefile);
+        unsigned base = names.size();
+        for (unsigned i = 0; i < map.numberOfSamples(); ++i)
+            names.push_back(map.name(i));
+        for (unsigned i = 0; i < texts; ++i)
+            p->samples.push_back(base + map.sample(i));
+    }
+    else
+    {
+        string name = filename;
+        std::size_t found = name.rfind(TextCollection::FMINDEX_EXTENSION);
+        if (found != string::npos && found + TextCollection::FMINDEX_EXTENSION.size() == name.size())
+            name.erase(found);
+        found = name.rfind('/');
+        if (found != string::npos)
+            name.erase(0, found + 1);
+        p->samples.assign(texts, names.size());
+        names.push_back(name);
+    }
+    if (verbose)
+        cerr << "Loaded " << filename << ": " << texts << " texts, " << p->index->getLength() << " symbols" << endl;
+    return p;
+}
+
+/**
+ * Merge b after a, both are deleted. The BWT of the result
+ * is built in external memory if a directory is given.
+ */
+Pool * mergePools(Pool *a, Pool *b, string const &dir)
+{
+    FMIndex const *x = a->index, *y = b->index;
+    ulong length = x->getLength() + y->getLength();
+    unsigned texts = x->getNumberOfTexts() + y->getNumberOfTexts();
+    ulong maxTextLength = std::max(x->getMaxTextLength(), y->getMaxTextLength());
+    unsigned samplerate = x->getSamplerate();
+
+    ExternalSequence *ext = dir.empty() ? 0 : new ExternalSequence(dir, externalBudget);
+    vector<bool> fromB;
+    fromB.reserve(texts);
+    uchar *bwt = FMIndex::mergeBWT(x, y, ext, &fromB);
+
+    Pool *p = new Pool();
+    p->samples.reserve(texts);
+    ulong i = 0, j = 0;
+    for (vector<bool>::const_iterator it = fromB.begin(); it != fromB.end(); ++it)
+        p->samples.push_back(*it ? b->samples[j++] : a->samples[i++]);
+    delete a;
+    delete b;
+
+    vector<string> noNames;
+    if (ext)
+        p->index = new FMIndex(*ext, samplerate, texts, maxTextLength, 0, noNames, false, false);
+    else
+        p->index = new FMIndex(bwt, length, samplerate, texts, maxTextLength, 0, noNames, false, false);
+    delete ext;
+    return p;
+}
+
+/**
+ * Merge pools[l..r] as a balanced tree, the left halves as OpenMP tasks
+ */
+Pool * mergeRange(vector<Pool *> &pools, unsigned l, unsigned r)
+{
+    if (l == r)
+        return pools[l];
+    unsigned m = l + (r - l) / 2;
+    Pool *a = 0, *b = 0;
+#ifdef PARALLEL_SUPPORT
+    #pragma omp task shared(a, pools)
+#endif
+    a = mergeRange(pools, l, m);
+    b = mergeRange(pools, m + 1, r);
+#ifdef PARALLEL_SUPPORT
+    #pragma omp taskwait
+#endif
+    return mergePools(a, b, "");
+}
+
+void print_usage(char const *name)
+{
+    cerr << "usage: " << name << " [options] <output> <index.fmi> <index.fmi> [...]" << endl
+         << "Check README or `" << name << " --help' for more information." << endl;
+}
+
+void print_help(char const *name)
+{
+    cerr << "usage: " << name << " [options] <output> <index.fmi> <index.fmi> [...]" << endl << endl
+         << "Merges the given indexes into one pooled index, stored as <output>.fmi." << endl
+         << "The sample of each text is stored in <output>.fmi" << SAMPLEMAP_EXTENSION << "." << endl << endl
+         << "Options:" << endl
+         << " -t <int>, --threads <int>     Threads used by the merges (default: all OpenMP" << endl
+         << "                               threads, see OMP_NUM_THREADS)." << endl
+         << " --external <dir>              Build the pooled index in external memory (see" << endl
+         << "                               builder --help)." << endl
+         << " --external-memory <int>       RAM budget of the external-memory construction" << endl
+         << "                               in MB (default " << ExternalSequence::DEFAULT_BUDGET/(1024*1024) << ")." << endl
+         << " --verify                      Read the pooled index back after saving it and" << endl
+         << "                               check the checksums of its sections." << endl
+         << " -h, --help                    Display command line options." << endl
+         << " -v, --verbose                 Print progress information." << endl;
+}
+
+int atoi_min(char const *value, int min, char const *parameter, char const *name)
+{
+    char *end = 0;
+    long i = std::strtol(value, &end, 10);
+    if (end == value || *end != 0 || i < min)
+    {
+        cerr << "indexmerge: argument of " << parameter << " must be an integer greater than or equal to " << min << endl
+             << "Check README or `" << name << " --help' for more information." << endl;
+        std::exit(1);
+    }
+    return i;
+}
+
+enum parameter_t { long_opt_external = 256, long_opt_external_memory, long_opt_verify };
+
+int main(int argc, char **argv)
+{
+    static struct option long_options[] =
+        {
+            {"threads",     required_argument, 0, 't'},
+            {"external",    required_argument, 0, long_opt_external},
+            {"external-memory", required_argument, 0, long_opt_external_memory},
+            {"verify",      no_argument,       0, long_opt_verify},
+            {"help",        no_argument,       0, 'h'},
+            {"verbose",     no_argument,       0, 'v'},
+            {0, 0, 0, 0}
+        };
+    int option_index = 0;
+    int c;
+#ifdef PARALLEL_SUPPORT
+    threads = omp_get_max_threads();
+#endif
+    while ((c = getopt_long(argc, argv, "t:hv", long_options, &option_index)) != -1)
+    {
+        switch(c)
+        {
+        case 't':
+            threads = atoi_min(optarg, 1, "-t, --threads", argv[0]);
+            break;
+        case long_opt_external:
+            externalDir = optarg;
+            break;
+        case long_opt_external_memory:
+            externalBudget = (ulong)atoi_min(optarg, 1, "--external-memory", argv[0]) * 1024 * 1024;
+            break;
+        case long_opt_verify:
+            verify = true;
+            break;
+        case 'h':
+            print_help(argv[0]);
+            return 0;
+        case 'v':
+            verbose = true;
+            break;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argc - optind < 3)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+#ifdef PARALLEL_SUPPORT
+    omp_set_num_threads(threads);
+#endif
+
+    string outputfile = argv[optind++];
+    time_t wctime = time(NULL);
+    try
+    {
+        vector<string> names;
+        vector<Pool *> pools;
+        for (; optind < argc; ++optind)
+            pools.push_back(loadPool(argv[optind], names));
+
+        // The subtrees of the last merge run in parallel,
+        // the last merge uses all threads itself
+        unsigned m = (pools.size() - 1) / 2;
+        Pool *a = 0, *b = 0;
+#ifdef PARALLEL_SUPPORT
+        #pragma omp parallel
+        #pragma omp single
+#endif
+        {
+#ifdef PARALLEL_SUPPORT
+            #pragma omp task shared(a, pools)
+#endif
+            a = mergeRange(pools, 0, m);
+            b = mergeRange(pools, m + 1, pools.size() - 1);
+#ifdef PARALLEL_SUPPORT
+            #pragma omp taskwait
+#endif
+        }
+        Pool *pool = mergePools(a, b, externalDir);
+
+        if (verbose)
+            cerr << "Saving " << pool->index->getNumberOfTexts() << " texts of " << names.size() << " samples to "
+                 << outputfile << TextCollection::FMINDEX_EXTENSION
+                 << " (elapsed " << std::difftime(time(NULL), wctime) << " s)" << endl;
+        pool->index->save(outputfile);
+        SampleMap(names, pool->samples).save(outputfile + TextCollection::FMINDEX_EXTENSION + SAMPLEMAP_EXTENSION);
+        delete pool;
+
+        if (verify)
+        {
+            if (verbose)
+                cerr << "Verifying " << outputfile << TextCollection::FMINDEX_EXTENSION << endl;
+            delete TextCollection::load(outputfile, "", TextCollection::MEMORY_MAPPED, true);
+        }
+    }
+    catch (std::exception const &e)
+    {
+        cerr << "indexmerge: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,253 @@
+/**
+ * Throughput benchmark of the builder input (MB/s of FASTA).
+ *
+ * Measures reading and transforming the records of the given FASTA
+ * file into the texts that are inserted into the index (sequence, '-',
+ * reverse complement, all reversed) with the streaming SequenceReader,
+ * and with the getline() and std::string based ingest used before it.
+ * FASTQ and compressed input (gzip, bgzip) are measured with the
+ * streaming reader only; MB/s are given for the decompressed input.
+ * The texts are written into a 64 MB buffer that stands in for the
+ * insert buffer of the index construction. Run it on a file that is in
+ * the page cache (the first round is a warm up) to measure the parsing,
+ * or on a cold file to see whether the ingest keeps up with the disk.
+ */
+#include "SequenceReader.h"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <sys/time.h>
+#include <getopt.h>
+
+using namespace std;
+
+double wallclock()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/**
+ * Stand-in for the insert buffer, restarts from the beginning when full
+ */
+class Sink
+{
+public:
+    static const ulong SIZE = 64*1024*1024;
+
+    Sink()
+        : bytes(0), checksum(0), buffer(new uchar[SIZE]), used(0)
+    { }
+    ~Sink()
+    { delete [] buffer; }
+
+    uchar * reserve(ulong m)
+    {
+        if (m + 1 > SIZE)
+        {
+            std::cerr << "ingestbench: record of " << m << " symbols does not fit the buffer" << std::endl;
+            std::exit(1);
+        }
+        if (used + m + 1 > SIZE)
+            used = 0;
+        return buffer + used;
+    }
+    void commit(ulong m)
+    {
+        checksum += buffer[used] + buffer[used + m - 1];
+        buffer[used + m] = 0;
+        used += m + 1;
+        bytes += m;
+    }
+
+    ulong bytes;
+    ulong checksum;
+
+private:
+    uchar *buffer;
+    ulong used;
+};
+
+/**
+ * Streaming ingest as in builder
+ */
+unsigned threads = 0;
+unsigned trimQuality = 0;
+bool plainFasta = true;
+
+ulong ingestStreaming(char const *file, Sink &sink)
+{
+    std::FILE *fp = std::fopen(file, "rb");
+    if (!fp)
+    {
+        cerr << "ingestbench: unable to read input file " << file << endl;
+        std::exit(1);
+    }
+    SequenceReader input(fp);
+    input.setTrimming(trimQuality);
+    if (threads)
+        input.setThreads(threads);
+    while (input.next())
+    {
+        if (input.length() == 0)
+            continue;
+        ulong m = 2*input.length() + 1;
+        SequenceReader::writeText(input.sequence(), input.length(), sink.reserve(m));
+        sink.commit(m);
+    }
+    ulong bytes = input.bytesRead();
+    plainFasta = input.format() == SequenceReader::FORMAT_FASTA
+        && input.compression() == SequenceReader::COMPRESSION_NONE;
+    std::fclose(fp);
+    return bytes;
+}
+
+/**
+ * The getline() based ingest: each record is copied through
+ * row, text and revcmpl, normalized and reversed in place,
+ * then copied into the insert buffer.
+ */
+void normalizeString(string &t)
+{
+    for (string::iterator it = t.begin(); it != t.end(); ++it)
+        switch (*it)
+        {
+        case 'a': *it = 'A'; break;
+        case 'c': *it = 'C'; break;
+        case 'g': *it = 'G'; break;
+        case 't': *it = 'T'; break;
+        case 'n': *it = 'N'; break;
+        case 'A': case 'C': case 'G': case 'T': case 'N':
+        case '0': case '1': case '2': case '3': case '.':
+            break;
+        default: *it = 'N'; break;
+        }
+}
+
+void complementString(string &t)
+{
+    for (string::iterator it = t.begin(); it != t.end(); ++it)
+        switch (*it)
+        {
+        case 'T': *it = 'A'; break;
+        case 'G': *it = 'C'; break;
+        case 'C': *it = 'G'; break;
+        case 'A': *it = 'T'; break;
+        }
+}
+
+void insertString(string &text, Sink &sink)
+{
+    normalizeString(text);
+    string revcmpl(text);
+    std::reverse(revcmpl.begin(), revcmpl.end());
+    complementString(revcmpl);
+    text.append(1, '-');
+    text.append(revcmpl);
+    std::reverse(text.begin(), text.end());
+    std::memcpy(sink.reserve(text.size()), text.c_str(), text.size());
+    sink.commit(text.size());
+}
+
+ulong ingestGetline(char const *file, Sink &sink)
+{
+    ifstream input(file);
+    if (!input.good())
+    {
+        cerr << "ingestbench: unable to read input file " << file << endl;
+        std::exit(1);
+    }
+    string text, name, row;
+    ulong bytes = 0;
+    while (getline(input, row).good())
+    {
+        bytes += row.size() + 1;
+        if (row[0] == '>')
+        {
+            row = row.substr(row.find_first_not_of(" \t", 1));
+            row = row.substr(0, row.find_first_of(" \t"));
+            if (text.size() > 0)
+                insertString(text, sink);
+            text.clear();
+            name = row;
+        }
+        else
+            text.append(row);
+    }
+    if (text.size() > 0)
+        insertString(text, sink);
+    return bytes;
+}
+
+void print_usage(char const *name)
+{
+    cerr << "usage: " << name << " [options] <input>" << endl
+         << "Options:" << endl
+         << " -r <rounds>    Repeat each measurement (default 3, best is reported)." << endl
+         << " -t <threads>   Threads to decompress bgzip input (default all)." << endl
+         << " -q <quality>   Trim FASTQ reads by the given quality threshold." << endl;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned rounds = 3;
+    int c;
+    while ((c = getopt(argc, argv, "r:t:q:")) != -1)
+    {
+        switch (c)
+        {
+        case 'r':
+            rounds = atoi(optarg);
+            break;
+        case 't':
+            threads = atoi(optarg);
+            break;
+        case 'q':
+            trimQuality = atoi(optarg);
+            break;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argc - optind != 1 || rounds == 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+    char const *file = argv[optind];
+
+    char const *names[2] = {"streaming", "getline"};
+    double best[2] = {0, 0};
+    ulong bytes[2] = {0, 0};
+    ulong symbols[2] = {0, 0};
+    ulong checksum = 0;
+    unsigned methods = 2;
+    for (unsigned r = 0; r <= rounds; ++r) // First round is a warm up
+        for (unsigned k = 0; k < methods; ++k)
+        {
+            Sink sink;
+            double t = wallclock();
+            bytes[k] = k == 0 ? ingestStreaming(file, sink) : ingestGetline(file, sink);
+            t = wallclock() - t;
+            symbols[k] = sink.bytes;
+            checksum += sink.checksum;
+            if (r > 0 && (best[k] == 0 || t < best[k]))
+                best[k] = t;
+            if (!plainFasta)
+                methods = 1;
+        }
+
+    cout << file << ": " << bytes[0] << " bytes" << endl;
+    for (unsigned k = 0; k < methods; ++k)
+        cout << names[k] << ": " << bytes[k] / best[k] / (1024*1024) << " MB/s, "
+             << symbols[k] << " symbols inserted" << endl;
+    cout << "checksum " << checksum << endl;
+    return 0;
+}
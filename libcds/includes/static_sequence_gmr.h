@@ -0,0 +1,56 @@
+/* static_sequence_gmr.h
+ * Copyright (C) 2008, Francisco Claude, all rights reserved.
+ *
+ * GMR
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef _STATIC_SEQUENCE_GMR_H
+#define _STATIC_SEQUENCE_GMR_H
+
+#include <basics.h>
+#include <static_sequence.h>
+#include <static_bitsequence.h>
+#include <static_sequence_builder.h>
+#include <static_bitsequence_builder.h>
+#include <cassert>
+#include <iostream>
+
+using namespace std;
+
+class static_sequence_gmr : public static_sequence {
+  public:
+    static_sequence_gmr(uint * sequence, uint n, uint chunk_length, static_bitsequence_builder * bmb, static_sequence_builder * ssb);
+    ~static_sequence_gmr();
+    virtual uint rank(uint c, uint j);
+    virtual uint select(uint c, uint j);
+    virtual uint access(uint j);
+    virtual uint size();
+    virtual uint save(FILE *fp);
+    static static_sequence_gmr * load(FILE *fp);
+
+  protected:
+    static_sequence_gmr();
+    void build(uint * sequence, static_bitsequence_builder * bmb, static_sequence_builder * ssb);
+    uint * get_ones(uint * sequence);
+
+    uint sigma, chunk_length;
+    static_sequence ** chunk;
+    static_bitsequence * B;
+};
+
+#endif
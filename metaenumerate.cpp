@@ -1,6 +1,7 @@
 #include "Query.h"
 #include "OutputWriter.h"
 #include "EnumerateQuery.h"
+#include "Numa.h"
 
 #include <sstream>
 #include <iostream>
@@ -24,6 +25,15 @@ struct host_info {
     string enforcepath;
 };
 
+/**
+ * One enumeration thread: index (sample) and the server it reports to.
+ */
+struct enumerate_job {
+    unsigned index;
+    unsigned replica; // NUMA node of the index replica
+    struct host_info host;
+};
+
 /**
  * Definitions for parsing command line options
  */
@@ -32,25 +42,47 @@ enum align_mode_t { mode_undef, mode_mismatch, mode_rotation,
 
 enum parameter_t { long_opt_all = 256, long_opt_maxgap,
                    long_opt_minprefix, long_opt_skip, long_opt_nreads,
-                   long_opt_debug, long_opt_recursion };
+                   long_opt_debug, long_opt_recursion, long_opt_bufsize, long_opt_bufdepth,
+                   long_opt_numa, long_opt_hugepages, long_opt_canonical };
+
+enum numa_mode_t { numa_none, numa_interleave, numa_replicate };
 
 void print_usage(char const *name)
 {
-    cerr << "usage: " << name << " [options] <index>  < hostinfo.txt" << endl
+    cerr << "usage: " << name << " [options] <index> [<index> ...]  < hostinfo.txt" << endl
          << "Check README or `" << name << " --help' for more information." << endl;
 }
 
 void print_help(char const *name)
 {
-    cerr << "usage: " << name << " [options] <index>  < hostinfo.txt" << endl
+    cerr << "usage: " << name << " [options] <index> [<index> ...]  < hostinfo.txt" << endl
          << endl
-         << " <index>        Index file." <<endl
+         << " <index>        Index file(s). Each index is loaded once and enumerated" << endl
+         << "                for every host listed in hostinfo.txt." <<endl
          << " hostinfo.txt   Text file containing list of hosts to connect to," << endl
          << "                port n:o, and path to enumerate (read from stdin)." <<endl <<endl
          << "Options: " <<endl
          << " --check        Check integrity of index and quit." << endl
          << " --port <p>     Connect to port <p>." <<endl
          << " --verbose      Print progress information." << endl
+         << " --buffer-size <kb>" << endl
+         << "                Size of one socket send buffer in kilobytes (default " << ClientSocket::DEFAULT_BUFFER_SIZE/1024 << ")." << endl
+         << " --buffer-depth <n>" << endl
+         << "                Number of send buffers per connection (default " << ClientSocket::DEFAULT_BUFFER_DEPTH << ")." << endl
+         << "                With n > 1 a sender thread drains full buffers while the" << endl
+         << "                enumeration continues; n = 1 sends synchronously." << endl
+         << "                The buffers of a connection take at most "
+         << ClientSocket::MAX_BUFFER_MEMORY/(1024*1024) << " MB in total." << endl
+         << " --numa <mode>  Placement of the index on NUMA systems:" << endl
+         << "                  none        use the shared file mapping (default)," << endl
+         << "                  interleave  copy the index interleaved over all nodes," << endl
+         << "                  replicate   copy the index to every node and pin each" << endl
+         << "                              enumeration thread next to its replica." << endl
+         << " --hugepages    Read the index into private memory backed by 2 MB huge" << endl
+         << "                pages (explicit if reserved, otherwise transparent)." << endl
+         << " --canonical    Report each substring and its reverse complement once," << endl
+         << "                under the lexicographically smaller strand (the server" << endl
+         << "                must be run with --canonical)." << endl
          << "Debug options:"<<endl
          << " --debug        Print more progress information." << endl;
 }
@@ -76,6 +108,39 @@ int atoi_min(char const *value, int min, char const *parameter, char const *name
     return i;
 }
 
+/**
+ * Load and sanity check one index, returns 0 on error
+ *
+ * If verify is set, the section checksums of the file are checked.
+ */
+TextCollection * loadIndex(string const &indexfile, TextCollection::MemoryMode mode, bool verbose, char const *name,
+                           bool verify = false)
+{
+    if (verbose) cerr << "Loading index " << indexfile << endl;
+    TextCollection *tc = 0; 
+    try
+    {
+        tc = TextCollection::load(indexfile, "", mode, verify);
+    }
+    catch (std::runtime_error const &e)
+    {
+        cerr << name << ": " << indexfile << ": " << e.what() << endl;
+        return 0;
+    }
+    // Sanity checks
+    if (!tc) {
+        cerr << name << ": could not read index file " << indexfile << endl;
+        return 0;
+    }
+    if (tc->isColorCoded())
+    {
+        cerr << name << ": index " << indexfile << " cannot be color coded." << endl;
+        delete tc;
+        return 0;
+    }
+    return tc;
+}
+
 string libname(string const &full)
 {
     size_t found;
@@ -143,6 +208,11 @@ int main(int argc, char **argv)
     bool checkonly = false;
     bool debug = false;
     bool verbose = false;
+    ulong bufsize = ClientSocket::DEFAULT_BUFFER_SIZE;
+    ulong bufdepth = ClientSocket::DEFAULT_BUFFER_DEPTH;
+    numa_mode_t numa = numa_none;
+    bool hugepages = false;
+    bool canonical = false;
 
 #ifndef PARALLEL_SUPPORT
             cerr << "metaenumerate: Parallel processing not currently available!" << endl 
@@ -158,6 +228,11 @@ int main(int argc, char **argv)
             {"verbose",   no_argument,       0, 'v'},
             {"help",      no_argument,       0, 'h'},
             {"debug",     no_argument,       0, long_opt_debug},
+            {"buffer-size",  required_argument, 0, long_opt_bufsize},
+            {"buffer-depth", required_argument, 0, long_opt_bufdepth},
+            {"numa",      required_argument, 0, long_opt_numa},
+            {"hugepages", no_argument,       0, long_opt_hugepages},
+            {"canonical", no_argument,       0, long_opt_canonical},
             {0, 0, 0, 0}
         };
     int option_index = 0;
@@ -179,6 +254,28 @@ int main(int argc, char **argv)
             break;
         case long_opt_debug:
             debug = true; break;
+        case long_opt_bufsize:
+            bufsize = 1024lu * atoi_min(optarg, 1, "--buffer-size", argv[0]); break;
+        case long_opt_bufdepth:
+            bufdepth = atoi_min(optarg, 1, "--buffer-depth", argv[0]); break;
+        case long_opt_hugepages:
+            hugepages = true; break;
+        case long_opt_canonical:
+            canonical = true; break;
+        case long_opt_numa:
+            if (string(optarg) == "none")
+                numa = numa_none;
+            else if (string(optarg) == "interleave")
+                numa = numa_interleave;
+            else if (string(optarg) == "replicate")
+                numa = numa_replicate;
+            else
+            {
+                cerr << argv[0] << ": invalid argument for --numa: " << optarg << endl;
+                print_usage(argv[0]);
+                return 1;
+            }
+            break;
         case '?': 
         case 'h':
             print_help(argv[0]);
@@ -188,15 +285,34 @@ int main(int argc, char **argv)
             std::abort ();
         }
     }
+    if (bufsize * bufdepth > ClientSocket::MAX_BUFFER_MEMORY)
+    {
+        cerr << "metaenumerate: --buffer-size times --buffer-depth must be at most "
+             << ClientSocket::MAX_BUFFER_MEMORY/1024 << " kilobytes" << endl
+             << "Check README or `" << argv[0] << " --help' for more information." << endl;
+        return 1;
+    }
 
     // Parse filenames
-    if (argc - optind != 1)
+    if (argc - optind < 1)
     {
         cerr << argv[0] << ": expecting index filename" << endl;
         print_usage(argv[0]);
         return 1;
     }
-    string indexfile = string(argv[optind++]);
+    vector<string> indexfiles;
+    while (optind < argc)
+    {
+        string indexfile = string(argv[optind++]);
+        for (vector<string>::iterator it = indexfiles.begin(); it != indexfiles.end(); ++it)
+            if (libname(*it) == libname(indexfile))
+            {
+                cerr << argv[0] << ": duplicate library name \"" << libname(indexfile) << "\" in " 
+                     << *it << " and " << indexfile << endl;
+                return 1;
+            }
+        indexfiles.push_back(indexfile);
+    }
 
     // Parse host name, port number and enforced path
     if (verbose) cerr << "reading stdin for hostinfo.txt" << endl;
@@ -233,29 +349,82 @@ int main(int argc, char **argv)
     /**
      * Initialize shared data structures
      */
-    if (verbose) cerr << "Loading index " << indexfile << endl;
-    TextCollection *tc = 0; 
-    tc = TextCollection::load(indexfile);
-    // Sanity checks
-    if (!tc) {
-        cerr << argv[0] << ": could not read index file " << indexfile << endl;
-        return 1;
+    if (checkonly) 
+    {
+        /**
+         * Simple check to compare index size vs backward search
+         */
+        for (vector<string>::iterator it = indexfiles.begin(); it != indexfiles.end(); ++it)
+        {
+            TextCollection *tc = loadIndex(*it, TextCollection::MEMORY_MAPPED, verbose, argv[0], true);
+            if (!tc)
+                return 1;
+            cerr << *it << ": ";
+//            fflush(stdout);
+            checkIndex(tc, verbose);
+            delete tc;
+        }
+        return 0;
     }
-    if (tc->isColorCoded())
+
+    // replicas[r][i] is the replica of the i'th index on NUMA node r
+    unsigned nreplicas = numa == numa_replicate ? Numa::nodes() : 1;
+    vector<vector<TextCollection *> > replicas(nreplicas, vector<TextCollection *>(indexfiles.size(), 0));
+    bool loadfailed = false;
+    TextCollection::MemoryMode memorymode = TextCollection::MEMORY_MAPPED;
+    if (hugepages)
+        memorymode = TextCollection::MEMORY_HUGEPAGES;
+    else if (numa != numa_none)
+        memorymode = TextCollection::MEMORY_COPY;
+    if (numa == numa_interleave)
+        if (!Numa::interleave())
+            cerr << argv[0] << ": warning: unable to set interleaved memory policy" << endl;
+    if (verbose && numa == numa_replicate) 
+        cerr << "Replicating indexes to " << nreplicas << " NUMA nodes" << endl;
+
+#pragma omp parallel for num_threads(nreplicas) schedule(static, 1)
+    for (unsigned r = 0; r < nreplicas; ++r)
     {
-        cerr << argv[0] << ": index " << indexfile << " cannot be color coded." << endl;
-        return 1;
+        // Loader thread of the replica r allocates its copy on node r
+        if (numa == numa_replicate && !Numa::bindThread(r))
+#pragma omp critical (CERR_OUTPUT)
+            cerr << argv[0] << ": warning: unable to bind to NUMA node " << r << endl;
+        
+        for (unsigned i = 0; i < indexfiles.size(); ++i)
+        {
+            replicas[r][i] = loadIndex(indexfiles[i], memorymode, verbose, argv[0]);
+            if (!replicas[r][i])
+#pragma omp atomic write
+                loadfailed = true;
+        }
+        if (numa == numa_replicate)
+            Numa::reset();
     }
+    if (numa == numa_interleave)
+        Numa::reset();
+    if (loadfailed)
+        return 1;
 
     /**
-     * Simple check to compare index size vs backward search
+     * Every (index, host) pair is enumerated by its own thread: the servers 
+     * consume all of their connections in lockstep, so a pair can not wait 
+     * for a free thread without stalling the other pairs.
+     * Jobs are popped from the back; keep the jobs of an index together.
      */
-    if (checkonly) 
-    {
-        cerr << indexfile << ": ";
-//        fflush(stdout);
-        return checkIndex(tc, verbose);
-    }
+    vector<struct enumerate_job> jobs;
+    for (unsigned i = indexfiles.size(); i > 0; --i)
+        for (vector<struct host_info>::iterator it = hosts.begin(); it != hosts.end(); ++it)
+        {
+            struct enumerate_job job;
+            job.index = i - 1;
+            job.replica = jobs.size() % nreplicas; // Spread threads evenly over the nodes
+            job.host = *it;
+            jobs.push_back(job);
+        }
+    if (verbose) cerr << "Starting " << jobs.size() << " enumeration threads for " << indexfiles.size() 
+                      << " indexes and " << hosts.size() << " hosts" << endl;
+    double remote_sum = 0;
+    unsigned remote_count = 0;
 
     // Dummy output writer
     OutputWriter *outputw = OutputWriter::build(OutputWriter::output_tabs, "");
@@ -265,29 +434,36 @@ int main(int argc, char **argv)
     ulong total_occs = 0;
     time_t wctime = time(NULL);
 
-#pragma omp parallel num_threads(hosts.size())
+#pragma omp parallel num_threads(jobs.size())
 {
     EnumerateQuery *query = 0; // Private query instances
+    TextCollection *tc = 0;
 
 #pragma omp critical (CERR_OUTPUT)
 {
-    struct host_info hi = hosts.back();
-    hosts.pop_back();
+    struct enumerate_job job = jobs.back();
+    jobs.pop_back();
+    struct host_info const &hi = job.host;
+    string const &indexfile = indexfiles[job.index];
     int tnum = omp_get_thread_num();
-    cerr << tnum << ": connecting to host_info " << hosts.size() << ": \"" << hi.name << "\" : " << hi.port << ", \"" << hi.enforcepath << "\"" << endl;
+    tc = replicas[job.replica][job.index];
+    if (numa == numa_replicate && !Numa::bindThread(job.replica))
+        cerr << tnum << ": warning: unable to bind to NUMA node " << job.replica << endl;
+    cerr << tnum << ": connecting to host_info " << jobs.size() << ": \"" << hi.name << "\" : " << hi.port << ", \"" << hi.enforcepath << "\" for " << libname(indexfile) << endl;
 
     /**
      * Initialize socket
      */
     if (verbose) cerr << "Init socket to " << hi.name << ":" << hi.port << endl;
-    ClientSocket *cs = new ClientSocket(hi.name, hi.port);
+    ClientSocket *cs = new ClientSocket(hi.name, hi.port, bufsize, bufdepth);
     if (verbose) cerr << "Socket connection succeeded, sending the header \"" << libname(indexfile) << "\"" << endl;
-    cs->putc('S'); // Start byte
+    cs->putc(canonical ? 'C' : 'S'); // Start byte, 'C' in canonical mode
     cs->putstring(libname(indexfile));
     if (verbose) cerr << "Header sent successfully." << endl;
 
-    query = new EnumerateQuery(tc, *outputw, verbose, cs, hi.enforcepath, fmin, maxdepth);
-    if (verbose) cerr << "Align mode: enumerate query with fmin = " << fmin << ", maxdepth = " << maxdepth << endl;
+    query = new EnumerateQuery(tc, *outputw, verbose, cs, hi.enforcepath, fmin, maxdepth, canonical);
+    if (verbose) cerr << "Align mode: enumerate query with fmin = " << fmin << ", maxdepth = " << maxdepth
+                      << (canonical ? ", canonical strands" : "") << endl;
     assert(query != 0);
     // Other query settings
     query->setDebug(debug);
@@ -305,12 +481,35 @@ int main(int argc, char **argv)
 #pragma omp atomic
         total_occs += reported;
 
+    if (verbose)
+    {
+        // Expected fraction of remote accesses: index pages on another node
+        TextCollection::region_vector regions;
+        tc->getRegions(regions);
+        unsigned node = Numa::currentNode();
+        double ratio = Numa::remoteRatio(regions, node);
+#pragma omp critical (CERR_OUTPUT)
+{
+        cerr << omp_get_thread_num() << ": remote-access ratio on node " << node << ": ";
+        if (ratio < 0)
+            cerr << "n/a" << endl;
+        else
+        {
+            cerr << 100.0*ratio << "%" << endl;
+            remote_sum += ratio;
+            ++remote_count;
+        }
+}
+    }
+
     delete query;
 } // end of #pragma omp parallel
 
     if (verbose)
     {	
         cerr << "Number of reported alignments: " << total_occs << endl;
+        if (remote_count)
+            cerr << "Average remote-access ratio: " << 100.0*remote_sum/remote_count << "%" << endl;
         cerr << "Wall-clock time: " << std::difftime(time(NULL), wctime) << " seconds (" 
              << std::difftime(time(NULL), wctime) / 3600 << " hours)" << endl;
 
@@ -319,5 +518,7 @@ int main(int argc, char **argv)
         cerr << "CPU time: " << tval.ru_utime.tv_sec << " seconds." << endl;
     }
 
-    delete tc;
+    for (unsigned r = 0; r < nreplicas; ++r)
+        for (vector<TextCollection *>::iterator it = replicas[r].begin(); it != replicas[r].end(); ++it)
+            delete *it;
 }
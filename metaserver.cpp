@@ -25,7 +25,7 @@ typedef unordered_set<unsigned> readerset;
 /**
  * Definitions for parsing command line options
  */
-enum parameter_t { long_opt_debug = 256, long_opt_discriminative, long_opt_pmax };
+enum parameter_t { long_opt_debug = 256, long_opt_discriminative, long_opt_pmax, long_opt_canonical };
 
 void print_usage(char const *name)
 {
@@ -52,6 +52,9 @@ void print_help(char const *name)
          << " -e,--emin <double> Minimum entropy to output (default 0.0)" << endl
          << " -F,--topfreq <p>   Print the top-p output frequencies." << endl
          << " -T,--toptimes <p>  Print the top-p latencies." << endl
+         << " --canonical        Report each substring and its reverse complement once," << endl
+         << "                    under the lexicographically smaller strand (the clients" << endl
+         << "                    must be run with --canonical)." << endl
          << " -v,--verbose       Print progress information." << endl
          << " --debug            More verbose but still safe." << endl
          << " -A,--outputall     Even more verbose (not safe)." << endl;
@@ -117,6 +120,7 @@ void printatr(vector<TrieReader *> tr)
 bool debug = false;
 bool outputall = false; // For debugging only!
 bool verbose = false;
+bool canonical = false;
 int positivesets = -1;
 int toptimes = 0;
 int topfreq = 0;
@@ -152,6 +156,16 @@ inline bool moreChildren(vector<readerset> const &children)
     return false;
 }
 
+/**
+ * In canonical mode, the nodes of the strands that are not canonical are
+ * closed bare by the clients (no occs or left-char) and are not output:
+ * the reverse complement has the same occs in every sample.
+ */
+inline bool bareNode()
+{
+    return canonical && !Tools::IsCanonical((uchar const *)path.data(), path.size());
+}
+
 /**
  * Updates the currently active triereaders by reading their next child.
  * Returns true if there are children remaining to be processed.
@@ -210,16 +224,27 @@ int readChild(unsigned reader)
  */
 void traverseOne(unsigned reader)
 {
+    int c = 0;
     // traverse children
-    while (readChild(reader) != 0)
+    while ((c = readChild(reader)) != 0)
+    {
+        path.push_back(c);
         traverseOne(reader);
+        path.resize (path.size () - 1); // path.pop_back();
+    }
 
     // Note: Even if output == false, we need to iterate through readOccs()
     TrieReader *tr = allreaders[reader];
+    if (bareNode())
+    {
+        tr->readBareClose();
+        ++total_paths;
+        return;
+    }
     tr->readOccs();
 
-/* FIXME this should not occur... if (path.size() <= 6)
-   tr->checkR(); // Checksum is written for nodes at levels <7.*/
+    if (path.size() <= 6)
+        tr->checkR(); // Checksum is written for nodes at levels <7.
 
     tr->readClose();  // Closing parenthesis is read & checked
     ++total_paths; // No output, pmin > 1 here
@@ -248,16 +273,29 @@ void traverseOneWithOutput(unsigned reader)
 
     // Note: Even if output == false, we need to iterate through readOccs()
     TrieReader *tr = allreaders[reader];
+    if (bareNode())
+    {
+        tr->readBareClose();
+        ++total_paths;
+        return;
+    }
     ulong occs = tr->readOccs();
 
     if (path.size() <= 6)
         tr->checkR(); // Checksum is written for nodes at levels <7.
 
     char leftChar = tr->readClose();  // Closing parenthesis is read & checked
+    bool branching = leftChar == '0' || leftChar == 'N';
+    if (canonical)
+    {
+        // The reverse complement is output instead, if it is left branching
+        leftChar = tr->getComplementLeftChar();
+        branching = branching || leftChar == '0' || leftChar == 'N';
+    }
 
     // Check if we output?
     ++total_paths;
-    if ((leftChar == '0' || leftChar == 'N') && path.size() >= mindepth) // assert (pmin == 1)
+    if (branching && path.size() >= mindepth) // assert (pmin == 1)
     {
         ++total_output;
         ++freqhistogram[0];
@@ -347,11 +385,22 @@ void traverse(readerset const &treaders)
         cerr << "error: trearders size was greater than expected: " << treaders.size() << " > " << allreaders.size() << endl;
         exit(1);
     }
+
+    if (bareNode())
+    {
+        for (readerset::const_iterator it = treaders.begin(); it != treaders.end(); ++it)
+            allreaders[*it]->readBareClose();
+        ++total_paths;
+        return;
+    }
     
     // Traverse currently active readers (post-order)
     // Note: Output only if path is not in every set
     // Note: Even if output == false, we need to iterate through readOccs()
     char leftChar = 0;
+    char rcLeftChar = 0;             // Reverse complement in canonical mode:
+    char rcChild = '0';              // its left-char, its children
+    unsigned rcChildReaders = 0;     // and the number of readers that have them
 
     int pfv = 0, nfv = 0;            // used to compute discriminative mining
     ulong sumN = allreaders.size();  // used to compute \sum_j n_j + d*1
@@ -385,6 +434,20 @@ void traverse(readerset const &treaders)
             leftChar = lChar;
         else if (leftChar != lChar)
             leftChar = 'N';
+        if (canonical)
+        {
+            lChar = tr->getComplementLeftChar();
+            if (rcLeftChar == 0)
+                rcLeftChar = lChar;
+            else if (rcLeftChar != lChar)
+                rcLeftChar = 'N';
+            char child = tr->getComplementChildren();
+            if (child != '0')
+            {
+                ++rcChildReaders;
+                rcChild = rcChild == '0' || rcChild == child ? child : 'N';
+            }
+        }
     }
     double entropy = log(sumN)/log(2) - sumNlogN/(double)sumN;
     if (smallest_entropy > entropy)
@@ -413,10 +476,22 @@ void traverse(readerset const &treaders)
     if (emax > 0 && (entropy < emin || entropy > emax))
         output = false;
 
+    bool branching = true;
     if (numberOfChildren == 1 && treaders.size() == atr.size())
-        output = false; // not right branching
+        branching = false; // not right branching
     if (leftChar == 'A' || leftChar == 'C' || leftChar == 'G' || leftChar == 'T')
-        output = false; // not left branching
+        branching = false; // not left branching
+    if (canonical && !branching)
+    {
+        // The reverse complement is output instead, if it is branching
+        branching = true;
+        if (rcChild != '0' && rcChild != 'N' && treaders.size() == rcChildReaders)
+            branching = false;
+        if (rcLeftChar == 'A' || rcLeftChar == 'C' || rcLeftChar == 'G' || rcLeftChar == 'T')
+            branching = false;
+    }
+    if (!branching)
+        output = false;
 
     double pvalue = 0;
     // Output condition for discriminative mining
@@ -529,6 +604,7 @@ int main(int argc, char **argv)
             {"help",           no_argument,       0, 'h'},
             {"debug",          no_argument,       0, long_opt_debug},
             {"outputall",      no_argument,       0, 'A'},
+            {"canonical",      no_argument,       0, long_opt_canonical},
             {0, 0, 0, 0}
         };
     int option_index = 0;
@@ -569,6 +645,8 @@ int main(int argc, char **argv)
             debug = true; break;
         case 'A':
             outputall = true; break;
+        case long_opt_canonical:
+            canonical = true; break;
         case '?': 
         case 'h':
             print_help(argv[0]);
@@ -660,6 +738,8 @@ int main(int argc, char **argv)
                  << " using pthreshold = " << PTHRESHOLD << " and alternative = " << fisheralt << endl;
         else
             cerr << "Using emin = " << emin << " and emax = " << emax << endl;
+        if (canonical)
+            cerr << "Reporting the canonical strands only" << endl;
     }
         
     posFreqVector = 0;
@@ -690,11 +770,16 @@ int main(int argc, char **argv)
         // Listen for incoming connections...
         ServerSocket *ss = ServerSocket::create(sockfd);
         char c = ss->getc();
-        if (c != 'S')
+        if (c != 'S' && c != 'C')
         {
             cerr << "received invalid start byte: " << (int)c << endl;
             return 1;
         }
+        if ((c == 'C') != canonical)
+        {
+            cerr << "received start byte " << c << ": the clients and the server must all be run with or without --canonical" << endl;
+            return 1;
+        }
         string name = ss->getstring();
         map<string,pair<int,bool> >::iterator found = libtoid.find(name);
         if (found == libtoid.end())
@@ -712,7 +797,7 @@ int main(int argc, char **argv)
                 cerr << ", " << it->first; 
         cerr << ")" << endl;
 
-        TrieReader *tr = new TrieReader(id, found->first, ss, verbose, debug, positive);
+        TrieReader *tr = new TrieReader(id, found->first, ss, verbose, debug, positive, canonical);
         if (! tr->good())
         {
             cerr << "unable to open input file: " << line << endl;
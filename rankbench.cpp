@@ -0,0 +1,450 @@
+/**
+ * Micro benchmark for the rank queries of the FM-index.
+ *
+ * Loads the given index with each memory mode and measures the
+ * throughput of random LF(c, i) queries (one HuffWT::rank per query).
+ * Then compares the rank/select implementations (table, popcnt, bmi2)
+ * on the index and on a random bit-vector of the same length. The
+ * bit-vector class is the one used by HuffWT (see BLOCKED_RANK).
+ * Finally the rank directory layouts of BitRank (default, fast and
+ * small) are compared by size (bytes/bit) and query time.
+ * With -e the LF-heavy enumeration workload of metaenumerate is
+ * measured as well, to compare HuffWT with WaveletMatrix, DNARank and
+ * RunLengthBWT (see WAVELET_MATRIX, DNA_RANK and RUN_LENGTH), with LF(), with LFAll() and with
+ * LFAllBatch() as in EnumerateQuery. With -b the random LF and LFAll
+ * queries are evaluated in batches (LFBatch, LFAllBatch) of size 1, 2,
+ * 4, ... up to the given size, to measure the lockstep evaluation.
+ * Use an index of realistic size: with small indexes everything fits
+ * into the caches and the TLB.
+ */
+#include "TextCollection.h"
+#include "HuffWT.h"
+#include "DNARank.h"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <sys/time.h>
+#include <getopt.h>
+
+using namespace std;
+
+double wallclock()
+{
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/**
+ * Print the amount of huge pages in use by this process
+ */
+void printHugePages()
+{
+    ifstream ifs("/proc/self/smaps_rollup");
+    string line;
+    while (getline(ifs, line))
+        if (line.compare(0, 13, "AnonHugePages") == 0 || line.compare(0, 15, "Private_Hugetlb") == 0)
+            cout << "  " << line << endl;
+}
+
+/**
+ * Random LF queries, returns ns/query
+ */
+double benchLF(TextCollection const *tc, vector<uchar> const &chars, vector<ulong> const &pos, ulong &checksum)
+{
+    double t = wallclock();
+    for (ulong i = 0; i < pos.size(); ++i)
+        checksum += tc->LF(chars[i], pos[i]);
+    return (wallclock() - t) * 1000000000.0 / pos.size();
+}
+
+/**
+ * Random LF queries in batches of b, returns ns/query
+ */
+double benchLFBatch(TextCollection const *tc, vector<uchar> const &chars, vector<ulong> const &pos, unsigned b, ulong &checksum)
+{
+    vector<ulong> out(b);
+    double t = wallclock();
+    for (ulong i = 0; i < pos.size(); i += b)
+    {
+        unsigned k = pos.size() - i < b ? pos.size() - i : b;
+        tc->LFBatch(&chars[i], &pos[i], &out[0], k);
+        for (unsigned j = 0; j < k; ++j)
+            checksum += out[j];
+    }
+    return (wallclock() - t) * 1000000000.0 / pos.size();
+}
+
+/**
+ * Random LFAll queries in batches of b, returns ns/query
+ */
+double benchLFAllBatch(TextCollection const *tc, vector<ulong> const &pos, unsigned b, ulong &checksum)
+{
+    vector<ulong> out(4*b);
+    double t = wallclock();
+    for (ulong i = 0; i < pos.size(); i += b)
+    {
+        unsigned k = pos.size() - i < b ? pos.size() - i : b;
+        tc->LFAllBatch(&pos[i], &out[0], k);
+        for (unsigned j = 0; j < 4*k; ++j)
+            checksum += out[j];
+    }
+    return (wallclock() - t) * 1000000000.0 / pos.size();
+}
+
+/**
+ * Depth-first enumeration of all substrings of length <= depth
+ * over ACGT occurring at least twice, as in EnumerateQuery.
+ * Returns the number of LF queries.
+ */
+ulong enumerate(TextCollection const *tc, ulong sp, ulong ep, unsigned depth, ulong &checksum)
+{
+    static const uchar dna[] = "ACGT";
+    if (depth == 0)
+        return 0;
+    ulong queries = 0;
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        ulong nsp = tc->LF(dna[i], sp-1);
+        ulong nep = tc->LF(dna[i], ep)-1;
+        queries += 2;
+        if (nsp < nep + 1 && nep - nsp >= 1)
+        {
+            checksum += nsp;
+            queries += enumerate(tc, nsp, nep, depth-1, checksum);
+        }
+    }
+    return queries;
+}
+
+/**
+ * Same as above using LFAll(), returns the number of LFAll queries
+ */
+ulong enumerateAll(TextCollection const *tc, ulong sp, ulong ep, unsigned depth, ulong &checksum)
+{
+    if (depth == 0)
+        return 0;
+    ulong nsp[4], nep[4];
+    tc->LFAll(sp-1, nsp);
+    tc->LFAll(ep, nep);
+    ulong queries = 2;
+    for (unsigned i = 0; i < 4; ++i)
+        if (nsp[i] < nep[i] && nep[i] - 1 - nsp[i] >= 1)
+        {
+            checksum += nsp[i];
+            queries += enumerateAll(tc, nsp[i], nep[i]-1, depth-1, checksum);
+        }
+    return queries;
+}
+
+/**
+ * Same as above using LFAllBatch() on both ends of the interval,
+ * returns the number of LFAll queries
+ */
+ulong enumerateBatch(TextCollection const *tc, ulong sp, ulong ep, unsigned depth, ulong &checksum)
+{
+    if (depth == 0)
+        return 0;
+    ulong pos[2] = {sp-1, ep};
+    ulong lf[2][4];
+    tc->LFAllBatch(pos, lf[0], 2);
+    ulong queries = 2;
+    for (unsigned i = 0; i < 4; ++i)
+        if (lf[0][i] < lf[1][i] && lf[1][i] - 1 - lf[0][i] >= 1)
+        {
+            checksum += lf[0][i];
+            queries += enumerateBatch(tc, lf[0][i], lf[1][i]-1, depth-1, checksum);
+        }
+    return queries;
+}
+
+/**
+ * Random rank/select queries on a bit-vector, returns ns/query
+ */
+typedef HuffWT::BitVector BitVector;
+
+template<class T>
+double benchRank(T const *br, vector<ulong> const &pos, ulong &checksum)
+{
+    double t = wallclock();
+    for (ulong i = 0; i < pos.size(); ++i)
+        checksum += br->rank(pos[i]);
+    return (wallclock() - t) * 1000000000.0 / pos.size();
+}
+
+/**
+ * Dependent rank queries: each position is derived from the previous
+ * result as in LF, so that the latency of rank is measured
+ */
+template<class T>
+double benchRankLatency(T const *br, ulong n, ulong queries, ulong &checksum)
+{
+    ulong x = 0;
+    double t = wallclock();
+    for (ulong i = 0; i < queries; ++i)
+        x = (br->rank(x) * 2654435761lu + i) % n;
+    checksum += x;
+    return (wallclock() - t) * 1000000000.0 / queries;
+}
+
+template<class T>
+double benchSelect(T const *br, vector<ulong> const &pos, bool zeros, ulong &checksum)
+{
+    double t = wallclock();
+    if (zeros)
+        for (ulong i = 0; i < pos.size(); ++i)
+            checksum += br->select0(pos[i]);
+    else
+        for (ulong i = 0; i < pos.size(); ++i)
+            checksum += br->select(pos[i]);
+    return (wallclock() - t) * 1000000000.0 / pos.size();
+}
+
+void print_usage(char const *name)
+{
+    cerr << "usage: " << name << " [options] <index>" << endl
+         << "Options:" << endl
+         << " -n <queries>   Number of random queries (default 10000000)." << endl
+         << " -r <rounds>    Repeat each measurement (default 3, best is reported)." << endl
+         << " -m <mode>      Memory mode: mapped, copy, hugepages or all (default)." << endl
+         << " -i <impl>      Rank/select implementation: table, popcnt, bmi2 or all (default)." << endl
+         << " -k <sample>    Select hint sample rate of the bit-vector, 0 disables (default " 
+         << SelectHints::DEFAULT_SAMPLE << ")." << endl
+         << " -e <depth>     Measure the enumeration of all substrings up to the given depth." << endl
+         << " -b <size>      Measure batched LF and LFAll queries with batch sizes up to the given size." << endl;
+}
+
+int main(int argc, char **argv)
+{
+    ulong queries = 10000000;
+    unsigned rounds = 3;
+    string mode = "all";
+    string impl = "all";
+    unsigned depth = 0;
+    unsigned batch = 0;
+    int c;
+    while ((c = getopt(argc, argv, "n:r:m:i:k:e:b:h")) != -1)
+    {
+        switch (c)
+        {
+        case 'n':
+            queries = atol(optarg); break;
+        case 'r':
+            rounds = atoi(optarg); break;
+        case 'm':
+            mode = string(optarg); break;
+        case 'i':
+            impl = string(optarg); break;
+        case 'k':
+            SelectHints::sample = atol(optarg); break;
+        case 'e':
+            depth = atoi(optarg); break;
+        case 'b':
+            batch = atoi(optarg); break;
+        case 'h':
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argc - optind != 1 || queries == 0 || rounds == 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+    string indexfile = argv[optind];
+
+    vector<pair<string, TextCollection::MemoryMode> > modes;
+    if (mode == "all" || mode == "mapped")
+        modes.push_back(make_pair(string("mapped"), TextCollection::MEMORY_MAPPED));
+    if (mode == "all" || mode == "copy")
+        modes.push_back(make_pair(string("copy"), TextCollection::MEMORY_COPY));
+    if (mode == "all" || mode == "hugepages")
+        modes.push_back(make_pair(string("hugepages"), TextCollection::MEMORY_HUGEPAGES));
+    if (modes.empty())
+    {
+        cerr << argv[0] << ": invalid memory mode " << mode << endl;
+        return 1;
+    }
+
+    // The same random queries for each mode
+    TextCollection *tc = TextCollection::load(indexfile);
+    if (!tc)
+    {
+        cerr << argv[0] << ": could not read index file " << indexfile << endl;
+        return 1;
+    }
+    ulong n = tc->getLength();
+    delete tc;
+    static const uchar dna[] = "ACGT";
+    vector<uchar> chars(queries);
+    vector<ulong> pos(queries);
+    srand(1);
+    for (ulong i = 0; i < queries; ++i)
+    {
+        chars[i] = dna[rand() % 4];
+        pos[i] = ((ulong)rand() * RAND_MAX + rand()) % n;
+    }
+    cout << indexfile << ": n = " << n << ", " << queries << " queries" << endl;
+#ifdef BLOCKED_RANK
+    cout << "Bit-vector: BlockedBitRank, implementation " << BitVector::implementation() << endl;
+#else
+    cout << "Bit-vector: BitRank, implementation " << BitVector::implementation() << endl;
+#endif
+#if defined(WAVELET_MATRIX)
+    cout << "BWT: WaveletMatrix" << endl;
+#elif defined(DNA_RANK)
+    cout << "BWT: DNARank" << endl;
+#elif defined(RUN_LENGTH)
+    cout << "BWT: RunLengthBWT" << endl;
+#else
+    cout << "BWT: HuffWT" << endl;
+#endif
+
+    ulong checksum = 0;
+    for (vector<pair<string, TextCollection::MemoryMode> >::iterator it = modes.begin(); it != modes.end(); ++it)
+    {
+        tc = TextCollection::load(indexfile, "", it->second);
+        benchLF(tc, chars, pos, checksum); // Warm up: page faults, caches
+        double best = 0;
+        for (unsigned r = 0; r < rounds; ++r)
+        {
+            double ns = benchLF(tc, chars, pos, checksum);
+            if (r == 0 || ns < best)
+                best = ns;
+        }
+        cout << it->first << ": LF " << best << " ns/query" << endl;
+        if (depth)
+        {
+            double t = wallclock();
+            ulong lfs = enumerate(tc, 0, n-1, depth, checksum);
+            t = wallclock() - t;
+            cout << it->first << ": enumeration depth " << depth << ", " << lfs << " LF queries, " 
+                 << t << " s, " << t * 1000000000.0 / lfs << " ns/query" << endl;
+            t = wallclock();
+            lfs = enumerateAll(tc, 0, n-1, depth, checksum);
+            t = wallclock() - t;
+            cout << it->first << ": enumeration depth " << depth << ", " << lfs << " LFAll queries, " 
+                 << t << " s, " << t * 1000000000.0 / lfs << " ns/query" << endl;
+            t = wallclock();
+            lfs = enumerateBatch(tc, 0, n-1, depth, checksum);
+            t = wallclock() - t;
+            cout << it->first << ": enumeration depth " << depth << ", " << lfs << " LFAll queries in batches of 2, " 
+                 << t << " s, " << t * 1000000000.0 / lfs << " ns/query" << endl;
+        }
+        for (unsigned b = 1; b <= batch; b *= 2)
+        {
+            double lf = 0, lfall = 0;
+            for (unsigned r = 0; r < rounds; ++r)
+            {
+                double ns = benchLFBatch(tc, chars, pos, b, checksum);
+                if (r == 0 || ns < lf)
+                    lf = ns;
+                ns = benchLFAllBatch(tc, pos, b, checksum);
+                if (r == 0 || ns < lfall)
+                    lfall = ns;
+            }
+            cout << it->first << ": batch " << b << ": LF " << lf << " ns/query, LFAll " 
+                 << lfall << " ns/query" << endl;
+        }
+        printHugePages();
+        delete tc;
+    }
+
+    /**
+     * Compare the rank/select implementations
+     */
+    vector<string> impls;
+    if (impl == "all" || impl == "table")
+        impls.push_back("table");
+    if (impl == "all" || impl == "popcnt")
+        impls.push_back("popcnt");
+    if (impl == "all" || impl == "bmi2")
+        impls.push_back("bmi2");
+    if (impls.empty())
+    {
+        cerr << argv[0] << ": invalid implementation " << impl << endl;
+        return 1;
+    }
+
+    // Random bit-vector of length n, half of the bits set
+    ulong *bits = new ulong[n/W + 1];
+    for (ulong i = 0; i < n/W + 1; ++i)
+        bits[i] = ((ulong)rand() << 40) ^ ((ulong)rand() << 20) ^ rand();
+    bits[n/W] &= (1lu << (n%W)) - 1;
+    BitVector *br = new BitVector(bits, n, true);
+    ulong ones = br->rank(n-1);
+    vector<ulong> selectpos(queries), select0pos(queries);
+    for (ulong i = 0; i < queries; ++i)
+    {
+        selectpos[i] = 1 + pos[i] % ones;
+        select0pos[i] = 1 + pos[i] % (n - ones);
+    }
+
+    tc = TextCollection::load(indexfile);
+    for (vector<string>::iterator it = impls.begin(); it != impls.end(); ++it)
+    {
+#ifdef DNA_RANK
+        DNARank::useImplementation(*it);
+#endif
+        if (!BitVector::useImplementation(*it))
+        {
+            cout << *it << ": not supported by the CPU" << endl;
+            continue;
+        }
+        double best[4] = {0, 0, 0, 0};
+        for (unsigned r = 0; r <= rounds; ++r) // First round is a warm up
+        {
+            double ns[4];
+            ns[0] = benchLF(tc, chars, pos, checksum);
+            ns[1] = benchRank(br, pos, checksum);
+            ns[2] = benchSelect(br, selectpos, false, checksum);
+            ns[3] = benchSelect(br, select0pos, true, checksum);
+            for (unsigned k = 0; k < 4; ++k)
+                if (r == 1 || ns[k] < best[k])
+                    best[k] = ns[k];
+        }
+        cout << *it << ": LF " << best[0] << " ns/query, rank " << best[1] 
+             << " ns/op, select " << best[2] << " ns/op, select0 " << best[3] << " ns/op" << endl;
+    }
+    delete tc;
+
+    /**
+     * Compare the rank directory layouts of BitRank (builder --rank-layout)
+     * on the same bit-array, with the last implementation above
+     */
+    static BitRank::Layout const layouts[] = {BitRank::LAYOUT_DEFAULT, BitRank::LAYOUT_FAST, BitRank::LAYOUT_SMALL};
+    for (unsigned l = 0; l < 3; ++l)
+    {
+        BitRank::layout = layouts[l];
+        BitRank *lr = new BitRank(bits, n, false);
+        vector<pair<void const *, ulong> > regions;
+        lr->getRegions(regions);
+        ulong bytes = 0;
+        for (ulong i = 0; i < regions.size(); ++i)
+            bytes += regions[i].second;
+        double best[3] = {0, 0, 0};
+        for (unsigned r = 0; r <= rounds; ++r)
+        {
+            double ns[3];
+            ns[0] = benchRank(lr, pos, checksum);
+            ns[1] = benchRankLatency(lr, n, queries, checksum);
+            ns[2] = benchSelect(lr, selectpos, false, checksum);
+            for (unsigned k = 0; k < 3; ++k)
+                if (r == 1 || ns[k] < best[k])
+                    best[k] = ns[k];
+        }
+        cout << "layout " << BitRank::layoutName(layouts[l]) << ": " << (double)bytes / n << " bytes/bit, rank " 
+             << best[0] << " ns/op, dependent rank " << best[1] << " ns/op, select " << best[2] << " ns/op" << endl;
+        delete lr;
+    }
+    BitRank::layout = BitRank::LAYOUT_DEFAULT;
+
+    delete br;
+    cerr << "checksum " << checksum << endl;
+    return 0;
+}